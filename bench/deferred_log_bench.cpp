@@ -0,0 +1,87 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+// Caller-side latency of a typical per-frame trace line through
+//   1. RAY_LOG on a synchronous RayLog (format + write on the caller),
+//   2. RAY_LOG on the asynchronous backend (format on the caller),
+//   3. RAY_LOGF on the asynchronous backend (arguments captured, formatted by the writer).
+//
+// usage: deferred_log_bench [log_dir] [iterations]
+
+#include "deferred_log.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Result {
+  double mean_ns;
+  double p50_ns;
+  double p99_ns;
+};
+
+template <typename Body> Result Measure(int iterations, Body&& body) {
+  std::vector<int64_t> samples;
+  samples.reserve(static_cast<size_t>(iterations));
+  for (int i = 0; i < iterations; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    body(i);
+    const auto end = std::chrono::steady_clock::now();
+    samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (auto sample : samples) {
+    total += static_cast<double>(sample);
+  }
+  return {total / static_cast<double>(samples.size()), static_cast<double>(samples[samples.size() / 2]),
+          static_cast<double>(samples[samples.size() * 99 / 100])};
+}
+
+void Print(const char* name, const Result& result) {
+  fmt::print("{:<28} mean {:>8.1f} ns   p50 {:>8.1f} ns   p99 {:>8.1f} ns\n", name, result.mean_ns, result.p50_ns,
+             result.p99_ns);
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+  const std::string log_dir    = argc > 1 ? argv[1] : "bench_logs/";
+  const int         iterations = argc > 2 ? std::atoi(argv[2]) : 100000;
+  const std::string camera     = "camera-017";
+
+  ray::RayLog::StartRayLog("deferred_log_bench_sync", ray::RayLogLevel::INFO, log_dir, false);
+  const Result sync_stream = Measure(iterations, [&](int i) {
+    RAY_LOG(INFO) << "frame " << i << " pts " << (int64_t{90000} * i) << " latency " << (i * 0.013) << " ms camera "
+                  << camera;
+  });
+
+  ray::RayLogAsyncOptions async_options;
+  async_options.enabled    = true;
+  async_options.queue_size = static_cast<size_t>(iterations) + 1;
+  ray::RayLog::StartRayLog("deferred_log_bench_async", ray::RayLogLevel::INFO, log_dir, false, async_options);
+  const Result async_stream = Measure(iterations, [&](int i) {
+    RAY_LOG(INFO) << "frame " << i << " pts " << (int64_t{90000} * i) << " latency " << (i * 0.013) << " ms camera "
+                  << camera;
+  });
+
+  ray::RayLog::StartRayLog("deferred_log_bench_deferred", ray::RayLogLevel::INFO, log_dir, false, async_options);
+  const Result async_deferred = Measure(iterations, [&](int i) {
+    RAY_LOGF(INFO, "frame {} pts {} latency {} ms camera {}", i, int64_t{90000} * i, i * 0.013, camera);
+  });
+  ray::RayLog::ShutDownRayLog();
+
+  fmt::print("{} iterations, caller-side latency per statement\n", iterations);
+  Print("RAY_LOG sync", sync_stream);
+  Print("RAY_LOG async", async_stream);
+  Print("RAY_LOGF async (deferred)", async_deferred);
+  return 0;
+}
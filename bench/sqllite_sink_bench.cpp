@@ -0,0 +1,69 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+// Insert rate of rotating_sqllite_sink for a few batch sizes, pragma settings and
+// index selections.
+//
+// usage: sqllite_sink_bench [db_dir] [rows]
+
+#include "sinks/rotating_sqllite_sink.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <spdlog/spdlog.h>
+#include <string>
+
+namespace {
+
+double RowsPerSecond(const std::string& db_dir, int rows, const vtpl::sqllite_options& options) {
+  const std::string name = fmt::format("bench_{}_{}_{}_{}{}{}", options.batch_size, options.journal_mode,
+                                       options.synchronous, options.index_time, options.index_level,
+                                       options.index_source);
+  // Large enough that the benchmark never rotates.
+  auto logger = vtpl::rotating_sqllite_logger_st(name, db_dir + name + ".db", size_t{1} << 40, 1, false, {}, options);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rows; ++i) {
+    logger->info("frame {} decoded camera {} pts {} latency {:.3f} ms", i, i % 64, int64_t{90000} * i, i * 0.013);
+  }
+  logger->flush();
+  const auto end = std::chrono::steady_clock::now();
+  spdlog::drop(name);
+  return rows / std::chrono::duration<double>(end - start).count();
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+  const std::string db_dir = argc > 1 ? argv[1] : "bench_logs/";
+  const int         rows   = argc > 2 ? std::atoi(argv[2]) : 500000;
+
+  auto options = [](std::size_t batch_size, const char* journal_mode, const char* synchronous, bool indexed) {
+    vtpl::sqllite_options options;
+    options.batch_size   = batch_size;
+    options.journal_mode = journal_mode;
+    options.synchronous  = synchronous;
+    options.index_time   = indexed;
+    options.index_level  = indexed;
+    return options;
+  };
+  const vtpl::sqllite_options configurations[] = {
+      options(1, "DELETE", "FULL", true),     // one transaction per row
+      options(1, "WAL", "NORMAL", true),      //
+      options(1000, "WAL", "NORMAL", false),  // no secondary index
+      options(1000, "WAL", "NORMAL", true),   // default
+      options(10000, "WAL", "NORMAL", true),  //
+      options(10000, "WAL", "OFF", true),     //
+  };
+  fmt::print("{} rows per configuration\n", rows);
+  for (const auto& options : configurations) {
+    // A row per transaction is far too slow for the full count.
+    const int n = options.batch_size == 1 ? rows / 100 : rows;
+    fmt::print("batch {:>6}  journal {:<6}  synchronous {:<6}  indexes {:<3}  {:>10.0f} rows/s\n", options.batch_size,
+               options.journal_mode, options.synchronous, options.index_time ? "yes" : "no",
+               RowsPerSecond(db_dir, n, options));
+  }
+  return 0;
+}
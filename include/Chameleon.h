@@ -27,11 +27,14 @@
 #ifndef CHAMELEON_H__
 #define CHAMELEON_H__
 
+#include <cstdint>
 #include <string>
 
 #include <core_export.h>
 #include <version.h>
 
+/// Text of a configuration value, with its number and truth value worked out
+/// once when it is set, so typed reads do not parse it again.
 class CORE_EXPORT Chameleon {
 public:
   Chameleon() = default;
@@ -46,11 +49,26 @@ public:
   Chameleon& operator=(std::string const&);
 
   operator std::string() const;
-  explicit             operator double() const;
+  explicit operator double() const { return number_; }
+
+  std::string const& Text() const { return value_; }
+  /// The number the text starts with, 0 if none, as std::atof reads it.
+  double AsDouble() const { return number_; }
+  /// The text as an integer: exact if it is one, else AsDouble() cut to an integer.
+  int64_t AsInt64() const { return integer_; }
+  /// True for a non-zero number, or for "true", "yes" or "on" in any case.
+  bool AsBool() const { return boolean_; }
+
   friend std::ostream& operator<<(std::ostream& outs, const Chameleon& p) { return outs << p.value_; }
 
 private:
+  /// Set the typed values from value_.
+  void Parse();
+
   std::string value_;
+  double      number_{0};
+  int64_t     integer_{0};
+  bool        boolean_{false};
 };
 
 #endif
\ No newline at end of file
@@ -2,26 +2,119 @@
 #define __CONFIG_FILE_H__
 
 #include <core_export.h>
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 #include <version.h>
 
 #include "Chameleon.h"
 
 class CORE_EXPORT ConfigFile {
-  // std::map<std::string, Chameleon> content_;
-  std::map<std::string, std::map<std::string, Chameleon>> sections_;
-  std::string                                             configFile_;
-  int                                                     need_to_save_{0};
-
 public:
+  /// One `name = value` line. `section` and `name` point into the text read from
+  /// the file, or into storage of the ConfigFile for entries added since.
+  struct Entry {
+    std::string_view section;
+    std::string_view name;
+    Chameleon        value;
+  };
+
   ConfigFile(std::string config_file);
   ~ConfigFile();
 
-  Chameleon const& Value(std::string const& section, std::string const& entry) const;
+  /// Copies and moves point the entries into their own text. Both a copy and its
+  /// original save their pending changes; a moved-from instance has none.
+  ConfigFile(const ConfigFile& other);
+  ConfigFile(ConfigFile&& other);
+  ConfigFile& operator=(const ConfigFile& other);
+  ConfigFile& operator=(ConfigFile&& other);
+
+  /// True if defaults were added, or the file did not exist, since the last Save().
+  bool NeedsSave() const { return need_to_save_ > 0; }
+  /// If NeedsSave(), add the entries added since the last Save() to the file as it
+  /// is on disk now, keeping the values found there, and replace the file with the
+  /// result if that differs. The file is written to `<file>.tmp` and renamed over
+  /// the old one, holding a lock on `<file>.lock`, so readers see the old or the
+  /// new file, never a part of one, and writers in other processes do not lose
+  /// each other's entries. The destructor calls it too.
+  ///
+  /// \return False if the file could not be written.
+  bool Save();
+  /// Forget the pending changes, so neither Save() nor the destructor writes them.
+  void DiscardChanges() {
+    need_to_save_  = 0;
+    saved_entries_ = entries_.size();
+  }
+
+  /// Value of `entry` in `section`, nullptr if there is no such entry.
+  const Chameleon* Find(std::string_view section, std::string_view entry) const;
+  bool             HasSection(std::string_view section) const;
+
+  /// Value of `entry` in `section`.
+  ///
+  /// \throw std::exception ("section does not exist" or "entry does not exist") if there is none.
+  Chameleon const& Value(std::string_view section, std::string_view entry) const;
+
+  /// All entries of `section` in name order, empty if there is no such section.
+  /// Looks at every entry, so it is meant for small files.
+  std::vector<const Entry*> Entries(std::string_view section) const;
+
+  /// Value of `entry` in `section`, adding it with `value` if there is none. The
+  /// entry is looked up once, and `value` is converted only if it is added.
+  ///
+  /// \return The value, and true if it was added.
+  template <typename T>
+  std::pair<Chameleon const*, bool> TryEmplace(std::string_view section, std::string_view entry, T&& value) {
+    const size_t slot = Slot(section, entry);
+    if (slots_[slot] != 0) {
+      return {&entries_[slots_[slot] - 1].value, false};
+    }
+    return {&Add(slot, section, entry, Chameleon(std::forward<T>(value))), true};
+  }
+
+  /// Value of `entry` in `section`, adding it with `value` if there is none.
+  Chameleon const& Value(std::string_view section, std::string_view entry, double value);
+  Chameleon const& Value(std::string_view section, std::string_view entry, std::string const& value);
+
+private:
+  /// Read the file in one piece and index its entries.
+  void Load();
+  /// Take the entries of `other`, leaving it empty with nothing to save.
+  void MoveFrom(ConfigFile& other);
+  /// Point the names of the entries, which point into `old_text` and `old_names`,
+  /// into text_ and names_, copies of them.
+  void Repoint(std::string_view old_text, const std::deque<std::string>& old_names);
+  /// The entries in the format of the file, sections and names in order.
+  std::string Serialize() const;
+  /// Position of (section, entry) in slots_, or of the empty slot it would take.
+  size_t Slot(std::string_view section, std::string_view entry) const;
+  /// Rebuild slots_ with `capacity` slots, a power of two.
+  void Rehash(size_t capacity);
+  /// Put a new entry in the empty `slot` returned by Slot(). `section` and `entry`
+  /// must outlive the instance.
+  Entry& Insert(size_t slot, std::string_view section, std::string_view entry, Chameleon value);
+  /// Add an entry in the empty `slot` returned by Slot(), copying its names.
+  Chameleon const& Add(size_t slot, std::string_view section, std::string_view entry, Chameleon value);
 
-  Chameleon const& Value(std::string const& section, std::string const& entry, double value);
-  Chameleon const& Value(std::string const& section, std::string const& entry, std::string const& value);
+  /// Content of the file, never changed after Load(): entries point into it.
+  std::string text_;
+  /// Section and entry names of entries added after Load().
+  std::deque<std::string> names_;
+  /// Every entry, in the order read or added; the deque keeps their addresses.
+  std::deque<Entry> entries_;
+  /// Number of entries_ read or saved; the ones after them are added defaults.
+  size_t saved_entries_{0};
+  /// Open addressing table of entries_ by section and name: the index of an
+  /// entry plus one, or 0 for an empty slot. At most half of them are used.
+  std::vector<uint32_t>                slots_;
+  std::unordered_set<std::string_view> sections_;
+  std::string                          configFile_;
+  int                                  need_to_save_{0};
 };
 
-#endif
\ No newline at end of file
+#endif
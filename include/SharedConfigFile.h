@@ -0,0 +1,83 @@
+#ifndef __SHARED_CONFIG_FILE_H__
+#define __SHARED_CONFIG_FILE_H__
+
+#include <core_export.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <version.h>
+
+#include "Chameleon.h"
+#include "ConfigFile.h"
+
+/// One ConfigFile for all the threads of a process. Lookups read an immutable
+/// snapshot of the configuration and never wait for a thread adding entries or
+/// saving. Adding a default takes a mutex and publishes a new snapshot, which
+/// shares the parsed file and the added entries with the old one and copies only
+/// an index of the entries added since the last Save().
+/// Values are returned by copy, as a snapshot may be replaced while they are used.
+class CORE_EXPORT SharedConfigFile {
+public:
+  explicit SharedConfigFile(std::string config_file);
+  /// Saves, like ConfigFile.
+  ~SharedConfigFile();
+
+  SharedConfigFile(const SharedConfigFile&)            = delete;
+  SharedConfigFile& operator=(const SharedConfigFile&) = delete;
+
+  /// Value of `entry` in `section`, std::nullopt if there is no such entry.
+  std::optional<Chameleon> Find(std::string_view section, std::string_view entry) const;
+
+  /// Value of `entry` in `section`, adding it with `value` if there is none.
+  Chameleon Value(std::string_view section, std::string_view entry, double value);
+  Chameleon Value(std::string_view section, std::string_view entry, std::string const& value);
+
+  /// True if defaults were added, or the file did not exist, since the last Save().
+  bool NeedsSave() const;
+  /// Write the added defaults to the file as ConfigFile::Save() does, and make the
+  /// file with them the new snapshot.
+  ///
+  /// \return False if the file could not be written.
+  bool Save();
+  /// Read the file again, for instance after it changed on disk. Defaults not
+  /// saved yet are kept unless the file now has them.
+  void Reload();
+
+private:
+  struct Added {
+    std::string section;
+    std::string name;
+    Chameleon   value;
+  };
+  struct Snapshot {
+    /// The file as read; never changed once published.
+    std::shared_ptr<const ConfigFile> file;
+    /// Whether the file did not exist when read.
+    bool missing{false};
+    /// Defaults added since `file` was read, in the order added. Only appended to,
+    /// under writer_mutex_, and shared by the snapshots until the next Save().
+    std::shared_ptr<std::deque<Added>> storage;
+    /// The entries of `storage` added before this snapshot, by section and name.
+    std::vector<const Added*> added;
+
+    const Chameleon* Find(std::string_view section, std::string_view entry) const;
+  };
+
+  /// Read configFile_ with the changes discarded, so it can be shared.
+  std::shared_ptr<const ConfigFile> Read(bool& missing) const;
+  std::shared_ptr<const Snapshot>   Current() const;
+  void                              Publish(std::shared_ptr<const Snapshot> snapshot);
+  Chameleon                         GetOrAdd(std::string_view section, std::string_view entry, Chameleon value);
+
+  std::string configFile_;
+  /// Serialises Value() adding an entry, Save() and Reload().
+  std::mutex writer_mutex_;
+  /// Read and replaced with std::atomic_load() and std::atomic_store().
+  std::shared_ptr<const Snapshot> snapshot_;
+};
+
+#endif
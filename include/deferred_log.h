@@ -0,0 +1,126 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef deferred_log_h
+#define deferred_log_h
+
+#include <cstdint>
+#include <cstring>
+#include <fmt/args.h>
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "logging.h"
+
+namespace ray {
+
+/// Structured logging with deferred formatting:
+///
+///   RAY_LOGF(INFO, "frame {} decoded in {:.2f} ms", frame_id, elapsed_ms);
+///
+/// The calling thread only copies the raw argument values into a compact binary
+/// record; the text is rendered by the writer thread of the asynchronous backend
+/// (see RayLogAsyncOptions), or right away when RayLog is synchronous.
+/// Arguments may be arithmetic values, enums, pointers, strings and trivially
+/// copyable types that have a fmt::formatter. The format must be a string literal.
+#define RAY_LOGF(level, format, ...)                                                                                   \
+  if constexpr (!RAY_LOG_LEVEL_ACTIVE(level)) {                                                                        \
+  } else if (::ray::RayLogSite& ray_log_site = RAY_LOG_SITE(level); !ray_log_site.IsEnabled()) {                       \
+  } else                                                                                                               \
+    ::ray::RayLogDeferred(ray_log_site, format, ##__VA_ARGS__)
+
+using DeferredArgStore = fmt::dynamic_format_arg_store<fmt::format_context>;
+
+/// Reads one argument from a record into `store` and returns the position after it.
+using DeferredArgDecoder = const char* (*)(const char* data, DeferredArgStore& store);
+
+/// Describes how to render a deferred record: everything but the argument bytes,
+/// which follow the descriptor in the record.
+struct DeferredLogFormat {
+  fmt::string_view          format;
+  const RayLogSite*         site{nullptr};
+  const DeferredArgDecoder* decoders{nullptr};
+  size_t                    arg_count{0};
+};
+
+/// How one argument type is stored in a record: trivially copyable values are
+/// copied byte for byte, strings as a 32 bit length followed by the characters.
+template <typename T> struct DeferredArgCodec {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "RAY_LOGF arguments must be trivially copyable values or strings");
+
+  static void Encode(fmt::memory_buffer& out, const T& value) {
+    const auto* bytes = reinterpret_cast<const char*>(&value);
+    out.append(bytes, bytes + sizeof(T));
+  }
+
+  static const char* Decode(const char* data, DeferredArgStore& store) {
+    alignas(T) unsigned char storage[sizeof(T)];
+    std::memcpy(storage, data, sizeof(T));
+    store.push_back(*reinterpret_cast<const T*>(storage));
+    return data + sizeof(T);
+  }
+};
+
+struct DeferredStringCodec {
+  static void Encode(fmt::memory_buffer& out, fmt::string_view value) {
+    const auto  size  = static_cast<uint32_t>(value.size());
+    const auto* bytes = reinterpret_cast<const char*>(&size);
+    out.append(bytes, bytes + sizeof(size));
+    out.append(value.data(), value.data() + size);
+  }
+
+  static const char* Decode(const char* data, DeferredArgStore& store) {
+    uint32_t size = 0;
+    std::memcpy(&size, data, sizeof(size));
+    data += sizeof(size);
+    store.push_back(fmt::string_view(data, size));
+    return data + size;
+  }
+};
+
+template <> struct DeferredArgCodec<const char*> : DeferredStringCodec {
+  static void Encode(fmt::memory_buffer& out, const char* value) {
+    DeferredStringCodec::Encode(out, value != nullptr ? fmt::string_view(value) : fmt::string_view("(null)"));
+  }
+};
+template <> struct DeferredArgCodec<char*> : DeferredArgCodec<const char*> {};
+template <> struct DeferredArgCodec<std::string> : DeferredStringCodec {};
+template <> struct DeferredArgCodec<fmt::string_view> : DeferredStringCodec {};
+template <> struct DeferredArgCodec<std::string_view> : DeferredStringCodec {};
+
+/// Compile-time table of decoders for one argument type list.
+template <typename... Args> struct DeferredArgTable {
+  static constexpr DeferredArgDecoder decoders[sizeof...(Args) + 1] = {&DeferredArgCodec<Args>::Decode..., nullptr};
+};
+template <typename... Args>
+constexpr DeferredArgDecoder DeferredArgTable<Args...>::decoders[sizeof...(Args) + 1];
+
+/// Queue an encoded record, or render and write it when RayLog is synchronous.
+void CORE_EXPORT PostDeferredLog(RayLogLevel severity, const DeferredLogFormat& format, const char* data,
+                                 size_t size);
+
+/// Render a deferred record as RAY_LOG would print it: "file:line: " then the text.
+void CORE_EXPORT RenderDeferredLog(const DeferredLogFormat& format, const char* data, fmt::memory_buffer& out);
+
+template <typename... Args>
+void RayLogDeferred(RayLogSite& site, fmt::format_string<Args...> format, const Args&... args) {
+  site.AddRecord();
+  DeferredLogFormat descriptor;
+  descriptor.format    = format;
+  descriptor.site      = &site;
+  descriptor.decoders  = DeferredArgTable<std::decay_t<Args>...>::decoders;
+  descriptor.arg_count = sizeof...(Args);
+
+  fmt::memory_buffer record;
+  (DeferredArgCodec<std::decay_t<Args>>::Encode(record, args), ...);
+  PostDeferredLog(site.Level(), descriptor, record.data(), record.size());
+}
+
+} // namespace ray
+
+#endif // deferred_log_h
@@ -0,0 +1,97 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef async_log_backend_h
+#define async_log_backend_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fmt/format.h>
+#include <memory>
+#include <mutex>
+#include <spdlog/common.h>
+#include <spdlog/logger.h>
+#include <thread>
+
+#include "deferred_log.h"
+#include "details/bounded_queue.h"
+#include "logging.h"
+
+namespace ray {
+
+/// A message captured on the calling thread, waiting for the writer thread.
+/// `payload` is either the formatted text or, for a deferred record, the encoded
+/// arguments that `format` renders; the source location is then that of its site.
+struct AsyncLogRecord {
+  spdlog::level::level_enum           level{spdlog::level::off};
+  spdlog::log_clock::time_point       time;
+  size_t                              thread_id{0};
+  bool                                deferred{false};
+  spdlog::source_loc                  source;
+  DeferredLogFormat                   format;
+  fmt::basic_memory_buffer<char, 256> payload;
+};
+
+/// Writer side of the asynchronous RayLog mode. Callers Post() the formatted
+/// text of a record into a bounded lock-free queue; a dedicated thread drains it
+/// into the sinks of `logger`, keeping the caller's timestamp and thread id.
+class AsyncLogBackend final {
+public:
+  AsyncLogBackend(std::shared_ptr<spdlog::logger> logger, size_t queue_size, RayLogOverflowPolicy overflow_policy);
+  ~AsyncLogBackend();
+
+  AsyncLogBackend(const AsyncLogBackend&)            = delete;
+  AsyncLogBackend(AsyncLogBackend&&)                 = delete;
+  AsyncLogBackend& operator=(const AsyncLogBackend&) = delete;
+  AsyncLogBackend& operator=(AsyncLogBackend&&)      = delete;
+
+  /// Queue one record, applying the overflow policy if the queue is full.
+  /// Once the backend is stopped, the record is written on the calling thread.
+  ///
+  /// \return False if the record was dropped.
+  bool Post(spdlog::level::level_enum level, spdlog::string_view_t payload, const spdlog::source_loc& source);
+
+  /// Queue a deferred record: `args` are the arguments encoded by RayLogDeferred,
+  /// rendered with `format` on the writer thread.
+  bool PostDeferred(spdlog::level::level_enum level, const DeferredLogFormat& format, spdlog::string_view_t args);
+
+  /// Block until every record posted before this call is written and flushed.
+  void Drain();
+
+  /// Drain the queue and join the writer thread. Later posts are written synchronously.
+  void Stop();
+
+  spdlog::logger& Logger() { return *logger_; }
+
+  /// Number of records lost to DROP_NEWEST or DROP_OLDEST since construction.
+  uint64_t DroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  template <typename Fill> bool PostRecord(spdlog::level::level_enum level, Fill&& fill);
+  void WorkerLoop();
+  void Write(const AsyncLogRecord& record);
+  void WakeWorker();
+
+  std::shared_ptr<spdlog::logger>              logger_;
+  RayLogOverflowPolicy                         overflow_policy_;
+  vtpl::details::bounded_queue<AsyncLogRecord> queue_;
+  /// Records accepted into the queue.
+  std::atomic<uint64_t> posted_{0};
+  /// Records that left the queue, either written or evicted by DROP_OLDEST.
+  std::atomic<uint64_t>   retired_{0};
+  std::atomic<uint64_t>   dropped_{0};
+  std::atomic<bool>       stopped_{false};
+  std::atomic<bool>       worker_sleeping_{false};
+  std::mutex              mutex_;
+  std::condition_variable wake_cv_;
+  std::condition_variable drained_cv_;
+  bool                    stop_requested_{false};
+  std::thread             worker_;
+};
+
+} // namespace ray
+
+#endif // async_log_backend_h
@@ -0,0 +1,105 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef binary_log_format_h
+#define binary_log_format_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// The file format of vtpl::sinks::binary_file_sink, read by binary_log_decoder.
+//
+// A file starts with a header:
+//   magic "VTPLBLOG", format version (1 byte), start time (int64 little endian,
+//   nanoseconds since the epoch), process id (uint32 little endian).
+// Then follow entries, each a varint body length and the body, whose first byte
+// is an entry_type:
+//   record:          zigzag varint time delta to the previous record (the first
+//                    one to the start time) in nanoseconds, level (1 byte),
+//                    varint thread id, varint logger id, varint source id (0 if
+//                    none), varint payload length, payload bytes
+//   logger_name:     varint id, varint length, name bytes
+//   source_location: varint id, varint line, varint length, file name bytes,
+//                    varint length, function name bytes
+// Ids are defined by an entry before the first record using them, and start over
+// in every file, so each file decodes on its own. Unknown entry types are skipped.
+namespace vtpl
+{
+namespace details
+{
+namespace binary_log
+{
+constexpr char magic[8] = {'V', 'T', 'P', 'L', 'B', 'L', 'O', 'G'};
+constexpr uint8_t version = 1;
+constexpr std::size_t header_size = sizeof(magic) + 1 + 8 + 4;
+// Longest varint of a 64 bit value.
+constexpr std::size_t max_varint_size = 10;
+
+enum class entry_type : uint8_t
+{
+  record = 0,
+  logger_name = 1,
+  source_location = 2
+};
+
+inline uint64_t zigzag_encode(int64_t value)
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value)
+{
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Write `value` at `out`, returning the position after it.
+inline char* put_varint(char* out, uint64_t value)
+{
+  while (value >= 0x80) {
+    *out++ = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = static_cast<char>(value);
+  return out;
+}
+
+// Read a varint from [in, end) into `value`, advancing `in`.
+// Returns false if the input ends or the varint is longer than max_varint_size.
+inline bool get_varint(const char*& in, const char* end, uint64_t& value)
+{
+  value = 0;
+  for (unsigned shift = 0; shift < 7 * max_varint_size && in < end; shift += 7) {
+    const auto byte = static_cast<uint8_t>(*in++);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline char* put_fixed(char* out, uint64_t value, std::size_t size)
+{
+  for (std::size_t i = 0; i < size; ++i) {
+    *out++ = static_cast<char>(value >> (8 * i));
+  }
+  return out;
+}
+
+inline uint64_t get_fixed(const char* in, std::size_t size)
+{
+  uint64_t value = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+  }
+  return value;
+}
+
+} // namespace binary_log
+} // namespace details
+} // namespace vtpl
+
+#endif // binary_log_format_h
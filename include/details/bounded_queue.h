@@ -0,0 +1,124 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef bounded_queue_h
+#define bounded_queue_h
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace vtpl
+{
+namespace details
+{
+
+// Bounded lock-free multi-producer queue (Dmitry Vyukov's array based queue).
+// Every slot carries a sequence number telling whether it is free for the
+// producer of that turn or ready for the consumer of that turn, so enqueue and
+// dequeue are one CAS each and never block each other.
+// Dequeue is safe from any thread, which lets producers evict the oldest entry
+// when the queue is full.
+// Slots are constructed once and filled in place through a callback, so a T that
+// owns a buffer keeps its capacity from one round trip to the next.
+template <typename T>
+class bounded_queue
+{
+public:
+  // capacity is rounded up to a power of two (minimum 2).
+  explicit bounded_queue(std::size_t capacity)
+  {
+    std::size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_.reset(new cell[size]);
+    for (std::size_t i = 0; i < size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bounded_queue(const bounded_queue&) = delete;
+  bounded_queue& operator=(const bounded_queue&) = delete;
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  // Claim a free slot and call fill(T&) on it. Returns false if the queue is full.
+  template <typename Fill>
+  bool try_enqueue(Fill&& fill)
+  {
+    cell* c = nullptr;
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &cells_[pos & mask_];
+      const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    fill(c->data);
+    c->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Take the oldest ready slot and call consume(T&) on it. Returns false if empty.
+  template <typename Consume>
+  bool try_dequeue(Consume&& consume)
+  {
+    cell* c = nullptr;
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &cells_[pos & mask_];
+      const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    consume(c->data);
+    c->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate number of queued entries.
+  std::size_t size_approx() const
+  {
+    const std::size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+    const std::size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+private:
+  static constexpr std::size_t cacheline_size = 64;
+
+  struct cell {
+    std::atomic<std::size_t> sequence{0};
+    T data;
+  };
+
+  std::unique_ptr<cell[]> cells_;
+  std::size_t mask_{0};
+  alignas(cacheline_size) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(cacheline_size) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+} // namespace details
+} // namespace vtpl
+
+#endif // bounded_queue_h
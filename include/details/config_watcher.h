@@ -0,0 +1,80 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef config_watcher_h
+#define config_watcher_h
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ray {
+
+/// What identifies one version of a file on disk.
+struct ConfigFileStamp {
+  bool                            exists{false};
+  std::filesystem::file_time_type mtime;
+  uintmax_t                       size{0};
+
+  static ConfigFileStamp Of(const std::string& path);
+
+  bool operator==(const ConfigFileStamp& other) const {
+    return exists == other.exists && mtime == other.mtime && size == other.size;
+  }
+  bool operator!=(const ConfigFileStamp& other) const { return !(*this == other); }
+};
+
+/// A background thread calling back when watched files change on disk. On Linux
+/// inotify on the parent directory wakes it right away, which also catches
+/// editors that replace a file by renaming; on every wake-up, and at least once
+/// per kPollInterval on any platform, the stamp of each watched file is compared
+/// with the last one seen. Callbacks run on the watcher thread.
+/// The instance is never destroyed, so files may be unwatched from static destructors.
+class ConfigWatcher final {
+public:
+  using Callback = std::function<void(const std::string& path)>;
+
+  static constexpr std::chrono::milliseconds kPollInterval{1000};
+
+  static ConfigWatcher& Instance();
+
+  ConfigWatcher(const ConfigWatcher&)            = delete;
+  ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+  /// Call on_change(path) whenever `path` changes, replacing an earlier callback for it.
+  void Watch(const std::string& path, Callback on_change);
+
+  /// After Unwatch() returns the callback of `path` is not running and will not run again.
+  /// Must not be called from a callback.
+  void Unwatch(const std::string& path);
+
+private:
+  struct Watched {
+    Callback        on_change;
+    ConfigFileStamp stamp;
+  };
+
+  ConfigWatcher();
+  ~ConfigWatcher() = default;
+  void Run();
+  /// Block until a watched directory reports an event or kPollInterval passes.
+  void WaitForEvents();
+
+  /// Held while callbacks run, so Unwatch() can wait for a running one.
+  std::mutex                     callback_mutex_;
+  std::mutex                     mutex_;
+  std::map<std::string, Watched> files_;
+  int                            inotify_fd_{-1};
+  std::thread                    thread_;
+};
+
+} // namespace ray
+
+#endif // config_watcher_h
@@ -0,0 +1,85 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef crash_ring_buffer_h
+#define crash_ring_buffer_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ray {
+
+/// Layout of a crash ring file, in the byte order of the writing machine.
+/// The header is followed by slot_count slots of kCrashRingSlotSize bytes.
+constexpr char     kCrashRingMagic[8]  = {'V', 'T', 'P', 'L', 'C', 'R', 'S', 'H'};
+constexpr uint32_t kCrashRingVersion   = 1;
+constexpr size_t   kCrashRingSlotSize  = 256;
+
+struct alignas(64) CrashRingHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t slot_size;
+  uint32_t slot_count;
+  uint32_t pid;
+  /// Index of the next record; record i goes to slot i % slot_count.
+  std::atomic<uint64_t> next;
+};
+
+struct CrashRingSlot {
+  /// Index of the record plus one once it is complete, 0 while it is written.
+  std::atomic<uint64_t> sequence;
+  int64_t               time_ns;
+  uint64_t              thread_id;
+  /// Bytes used in `text`; longer records are cut.
+  uint16_t size;
+  /// spdlog level.
+  int8_t  level;
+  uint8_t reserved[5];
+  char    text[kCrashRingSlotSize - 32];
+};
+
+static_assert(sizeof(CrashRingSlot) == kCrashRingSlotSize, "crash ring slots must be kCrashRingSlotSize bytes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "crash ring writes must not take locks");
+
+/// Fixed-size ring of the last records of a process, in a file mapped into
+/// memory. Records are written to the mapping with plain stores, so they reach
+/// the page cache as they are made and are on disk after the process dies,
+/// however it dies, without any write or flush call.
+/// Append() takes no lock and does not allocate, so signal handlers may use it.
+/// Writers racing for a slot a whole ring apart may tear it; readers skip slots
+/// whose sequence does not match their position.
+/// A ring is never unmapped, so it can be written to until the process ends.
+class CrashRingBuffer final {
+public:
+  /// Create or truncate `path` with room for `capacity` bytes of records, rounded
+  /// down to a power of two number of slots, and map it. `path` must not be
+  /// mapped by a ring of this process already: truncating it would fault both.
+  ///
+  /// \return nullptr, after printing why to stderr, if the file cannot be mapped.
+  static CrashRingBuffer* Open(const std::string& path, size_t capacity);
+
+  CrashRingBuffer(const CrashRingBuffer&)            = delete;
+  CrashRingBuffer& operator=(const CrashRingBuffer&) = delete;
+
+  /// Store one record, cut to the text capacity of a slot. Async-signal-safe.
+  void Append(int64_t time_ns, uint64_t thread_id, int level, const char* text, size_t size);
+
+  const std::string& Path() const { return path_; }
+
+private:
+  CrashRingBuffer(std::string path, CrashRingHeader* header, uint64_t slot_count);
+  ~CrashRingBuffer() = default;
+
+  std::string      path_;
+  CrashRingHeader* header_;
+  CrashRingSlot*   slots_;
+  uint64_t         mask_;
+};
+
+} // namespace ray
+
+#endif // crash_ring_buffer_h
@@ -18,17 +18,23 @@
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include <thread>
 #include <tuple>
+#include <utility>
 
 namespace vtpl
 {
 namespace details
 {
-VTPL_INLINE file_sqllite_helper::file_sqllite_helper(const vtpl::sqllite_event_handlers& event_handlers)
-    : event_handlers_(event_handlers)
+VTPL_INLINE file_sqllite_helper::file_sqllite_helper(const vtpl::sqllite_event_handlers& event_handlers,
+                                                     vtpl::sqllite_options options)
+    : event_handlers_(event_handlers), options_(std::move(options))
 {
+  if (options_.batch_size == 0) {
+    options_.batch_size = 1;
+  }
 }
 VTPL_INLINE file_sqllite_helper::~file_sqllite_helper() { close(); }
 
@@ -37,9 +43,6 @@ VTPL_INLINE void file_sqllite_helper::open(const spdlog::filename_t& fname, bool
   close();
   filename_ = fname;
 
-  auto* mode = SPDLOG_FILENAME_T("ab");
-  auto* trunc_mode = SPDLOG_FILENAME_T("wb");
-
   if (event_handlers_.before_open) {
     event_handlers_.before_open(filename_);
   }
@@ -48,28 +51,45 @@ VTPL_INLINE void file_sqllite_helper::open(const spdlog::filename_t& fname, bool
     // create containing folder if not exists already.
     spdlog::details::os::create_dir(spdlog::details::os::dir_name(fname));
     if (truncate) {
-      // Truncate by opening-and-closing a tmp file in "wb" mode, always
-      // opening the actual log-we-write-to in "ab" mode, since that
-      // interacts more politely with eternal processes that might
-      // rotate/truncate the file underneath us.
-      std::FILE* tmp;
-      if (spdlog::details::os::fopen_s(&tmp, fname, trunc_mode)) {
+      // A database cannot be truncated in place: remove it together with the
+      // journal files a previous connection may have left behind.
+      (void)spdlog::details::os::remove(fname + SPDLOG_FILENAME_T("-wal"));
+      (void)spdlog::details::os::remove(fname + SPDLOG_FILENAME_T("-shm"));
+      (void)spdlog::details::os::remove(fname + SPDLOG_FILENAME_T("-journal"));
+      if (spdlog::details::os::path_exists(fname) && spdlog::details::os::remove(fname) != 0) {
+        spdlog::details::os::sleep_for_millis(open_interval_);
         continue;
       }
-      std::fclose(tmp);
     }
-    if (!sqlite3_open(fname.c_str(), &fd_)) {
+    if (sqlite3_open(fname.c_str(), &fd_) == SQLITE_OK) {
+      if (!options_.journal_mode.empty()) {
+        exec_(("PRAGMA journal_mode=" + options_.journal_mode + ";").c_str());
+      }
+      if (!options_.synchronous.empty()) {
+        exec_(("PRAGMA synchronous=" + options_.synchronous + ";").c_str());
+      }
+      create_schema_();
+      int rc = sqlite3_prepare_v2(
+          fd_, "INSERT INTO data (ts, level, thread, logger, file, line, msg) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7);",
+          -1, &insert_stmt_, nullptr);
+      if (rc != SQLITE_OK) {
+        throw_sqlite_error_("Failed preparing insert on", rc);
+      }
+      rc = sqlite3_prepare_v2(fd_, "PRAGMA page_count;", -1, &page_count_stmt_, nullptr);
+      if (rc != SQLITE_OK) {
+        throw_sqlite_error_("Failed preparing page count on", rc);
+      }
+      // Read once: the page size of a database cannot change while rows are written.
+      page_size_ = static_cast<std::size_t>(query_int64_("PRAGMA page_size;"));
+      empty_ = query_int64_("SELECT EXISTS (SELECT 1 FROM data);") == 0;
+      measure_size_();
       if (event_handlers_.after_open) {
         event_handlers_.after_open(filename_, fd_);
       }
-      char* errMsg = nullptr;
-      int rs = sqlite3_exec(fd_, "create table data(id INTEGER PRIMARY KEY ASC, msg);", NULL, NULL, &errMsg);
-      if (rs != SQLITE_OK) {
-        std::cout << "Error in creating table: " << rs << " msg: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-      }
       return;
     }
+    sqlite3_close(fd_);
+    fd_ = nullptr;
     spdlog::details::os::sleep_for_millis(open_interval_);
   }
   spdlog::throw_spdlog_ex("Failed opening file " + spdlog::details::os::filename_to_str(filename_) + " for writing",
@@ -86,25 +106,40 @@ VTPL_INLINE void file_sqllite_helper::reopen(bool truncate)
 
 VTPL_INLINE void file_sqllite_helper::flush()
 {
-  // if (std::fflush(fd_) != 0) {
-  //   spdlog::throw_spdlog_ex("Failed flush to file " + spdlog::details::os::filename_to_str(filename_), errno);
-  // }
+  if (fd_ != nullptr) {
+    commit_();
+    measure_size_();
+  }
 }
 
 VTPL_INLINE void file_sqllite_helper::sync()
 {
-  // if (!spdlog::details::os::fsync(fd_)) {
-  //   spdlog::throw_spdlog_ex("Failed to fsync file " + spdlog::details::os::filename_to_str(filename_), errno);
-  // }
+  if (fd_ != nullptr) {
+    commit_();
+    exec_("PRAGMA wal_checkpoint(FULL);");
+  }
 }
 
-VTPL_INLINE void file_sqllite_helper::close()
+VTPL_INLINE void file_sqllite_helper::close(bool checkpoint)
 {
   if (fd_ != nullptr) {
     if (event_handlers_.before_close) {
       event_handlers_.before_close(filename_, fd_);
     }
 
+    if (in_transaction_) {
+      // Never throw from here, close() runs in destructors.
+      sqlite3_exec(fd_, "COMMIT;", nullptr, nullptr, nullptr);
+      in_transaction_ = false;
+      rows_in_transaction_ = 0;
+    }
+    sqlite3_finalize(insert_stmt_);
+    insert_stmt_ = nullptr;
+    sqlite3_finalize(page_count_stmt_);
+    page_count_stmt_ = nullptr;
+    if (!checkpoint) {
+      sqlite3_db_config(fd_, SQLITE_DBCONFIG_NO_CKPT_ON_CLOSE, 1, nullptr);
+    }
     sqlite3_close(fd_);
     fd_ = nullptr;
 
@@ -114,34 +149,134 @@ VTPL_INLINE void file_sqllite_helper::close()
   }
 }
 
-VTPL_INLINE void file_sqllite_helper::write(const spdlog::memory_buf_t& buf)
+VTPL_INLINE void file_sqllite_helper::write(const spdlog::details::log_msg& msg)
+{
+  if (!in_transaction_) {
+    begin_();
+  }
+  const auto ts = std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count();
+  // The statement is stepped right away, so sqlite does not need its own copy of the text.
+  int rc = sqlite3_bind_int64(insert_stmt_, 1, static_cast<sqlite3_int64>(ts));
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_bind_int(insert_stmt_, 2, static_cast<int>(msg.level));
+  }
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_bind_int64(insert_stmt_, 3, static_cast<sqlite3_int64>(msg.thread_id));
+  }
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_bind_text(insert_stmt_, 4, msg.logger_name.data(), static_cast<int>(msg.logger_name.size()),
+                           SQLITE_STATIC);
+  }
+  if (rc == SQLITE_OK) {
+    rc = msg.source.empty() ? sqlite3_bind_null(insert_stmt_, 5)
+                            : sqlite3_bind_text(insert_stmt_, 5, msg.source.filename, -1, SQLITE_STATIC);
+  }
+  if (rc == SQLITE_OK) {
+    rc = msg.source.empty() ? sqlite3_bind_null(insert_stmt_, 6) : sqlite3_bind_int(insert_stmt_, 6, msg.source.line);
+  }
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_bind_text(insert_stmt_, 7, msg.payload.data(), static_cast<int>(msg.payload.size()), SQLITE_STATIC);
+  }
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_step(insert_stmt_);
+  }
+  sqlite3_reset(insert_stmt_);
+  if (rc != SQLITE_DONE) {
+    throw_sqlite_error_("Failed writing to", rc);
+  }
+  empty_ = false;
+  estimated_size_ += estimated_row_size_(msg);
+  if (++rows_in_transaction_ >= options_.batch_size) {
+    commit_();
+    measure_size_();
+  }
+}
+
+VTPL_INLINE void file_sqllite_helper::exec_(const char* sql)
+{
+  const int rc = sqlite3_exec(fd_, sql, nullptr, nullptr, nullptr);
+  if (rc != SQLITE_OK) {
+    throw_sqlite_error_(std::string("Failed executing \"") + sql + "\" on", rc);
+  }
+}
+
+VTPL_INLINE sqlite3_int64 file_sqllite_helper::query_int64_(const char* sql)
 {
-  auto msg_size = buf.size();
-  auto data = buf.data();
-  std::string str(data, msg_size);
-  std::cout << "data: " << str << std::endl;
-  std::string s = spdlog::fmt_lib::format("insert into data (msg) VALUES ('kkkk');", str);
-  char* errMsg = nullptr;
-  int rs = sqlite3_exec(fd_, s.c_str(), NULL, NULL, &errMsg);
-  if (rs != SQLITE_OK) {
-    std::cout << "Error in creating table: " << rs << " msg: " << errMsg << std::endl;
-    sqlite3_free(errMsg);
+  sqlite3_stmt* stmt = nullptr;
+  int rc = sqlite3_prepare_v2(fd_, sql, -1, &stmt, nullptr);
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_step(stmt);
   }
-  // if (std::fwrite(data, 1, msg_size, fd_) != msg_size) {
-  //   spdlog::throw_spdlog_ex("Failed writing to file " + spdlog::details::os::filename_to_str(filename_), errno);
-  // }
+  const sqlite3_int64 value = rc == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_ROW) {
+    throw_sqlite_error_(std::string("Failed executing \"") + sql + "\" on", rc);
+  }
+  return value;
+}
+
+VTPL_INLINE void file_sqllite_helper::create_schema_()
+{
+  static const char* const columns[][2] = {
+      {"ts", "INTEGER"}, {"level", "INTEGER"}, {"thread", "INTEGER"}, {"logger", "TEXT"},
+      {"file", "TEXT"},  {"line", "INTEGER"},  {"msg", "TEXT"},
+  };
+
+  exec_("CREATE TABLE IF NOT EXISTS data(id INTEGER PRIMARY KEY ASC, ts INTEGER, level INTEGER, thread INTEGER, "
+        "logger TEXT, file TEXT, line INTEGER, msg TEXT);");
+
+  // Bring a table of an older layout up to date.
+  sqlite3_stmt* table_info = nullptr;
+  const int rc = sqlite3_prepare_v2(fd_, "PRAGMA table_info(data);", -1, &table_info, nullptr);
+  if (rc != SQLITE_OK) {
+    throw_sqlite_error_("Failed reading the schema of", rc);
+  }
+  bool present[sizeof(columns) / sizeof(columns[0])] = {};
+  while (sqlite3_step(table_info) == SQLITE_ROW) {
+    const auto* name = reinterpret_cast<const char*>(sqlite3_column_text(table_info, 1));
+    for (std::size_t i = 0; name != nullptr && i < sizeof(columns) / sizeof(columns[0]); ++i) {
+      present[i] = present[i] || std::strcmp(name, columns[i][0]) == 0;
+    }
+  }
+  sqlite3_finalize(table_info);
+  for (std::size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); ++i) {
+    if (!present[i]) {
+      exec_((std::string("ALTER TABLE data ADD COLUMN ") + columns[i][0] + " " + columns[i][1] + ";").c_str());
+    }
+  }
+
+  if (options_.index_time) {
+    exec_("CREATE INDEX IF NOT EXISTS data_ts ON data(ts);");
+  }
+  if (options_.index_level) {
+    exec_("CREATE INDEX IF NOT EXISTS data_level_ts ON data(level, ts);");
+  }
+  if (options_.index_source) {
+    exec_("CREATE INDEX IF NOT EXISTS data_source ON data(file, line);");
+  }
+}
+
+VTPL_INLINE void file_sqllite_helper::begin_()
+{
+  exec_("BEGIN;");
+  in_transaction_ = true;
+  rows_in_transaction_ = 0;
 }
 
-int size_callback(void* result, int argc, char** argv, char** columns)
+VTPL_INLINE void file_sqllite_helper::commit_()
 {
-  std::cout << "size_callback:: column(s)-> " << argc << std::endl;
-  for (int idx = 0; idx < argc; idx++) {
-    std::cout << "size_callback:: data-> " << columns[idx] << " , " << argv[idx] << std::endl;
+  if (!in_transaction_) {
+    return;
   }
-  (*(int*)result) = 4096;
-  std::cout << "size_callback:: " << argv[0] << std::endl;
+  in_transaction_ = false;
+  rows_in_transaction_ = 0;
+  exec_("COMMIT;");
+}
 
-  return 0;
+VTPL_INLINE void file_sqllite_helper::throw_sqlite_error_(const std::string& what, int rc)
+{
+  spdlog::throw_spdlog_ex(what + " " + spdlog::details::os::filename_to_str(filename_) + ": " +
+                          (fd_ != nullptr ? sqlite3_errmsg(fd_) : sqlite3_errstr(rc)));
 }
 
 VTPL_INLINE size_t file_sqllite_helper::size() const
@@ -149,17 +284,48 @@ VTPL_INLINE size_t file_sqllite_helper::size() const
   if (fd_ == nullptr) {
     spdlog::throw_spdlog_ex("Cannot use size() on closed file " + spdlog::details::os::filename_to_str(filename_));
   }
+  return measured_size_ + estimated_size_;
+}
+
+VTPL_INLINE size_t file_sqllite_helper::exact_size()
+{
+  if (fd_ == nullptr) {
+    spdlog::throw_spdlog_ex("Cannot use exact_size() on closed file " +
+                            spdlog::details::os::filename_to_str(filename_));
+  }
+  measure_size_();
+  return measured_size_;
+}
 
-  // char* size = (char*)malloc(sizeof(char) * sizeof(size_t));
-  int size = 0;
-  sqlite3_exec(fd_, "select * from pragma_page_size();", size_callback, &size, NULL);
-  // std::cout << "size_callback:: returns-> " << atoi(size) << std::endl;
+VTPL_INLINE bool file_sqllite_helper::empty() const { return empty_; }
+
+VTPL_INLINE void file_sqllite_helper::measure_size_()
+{
+  // The page count seen by this connection includes pages of the open
+  // transaction and frames still in the WAL.
+  const int rc = sqlite3_step(page_count_stmt_);
+  if (rc != SQLITE_ROW) {
+    sqlite3_reset(page_count_stmt_);
+    throw_sqlite_error_("Failed reading the page count of", rc);
+  }
+  measured_size_ = static_cast<std::size_t>(sqlite3_column_int64(page_count_stmt_, 0)) * page_size_;
+  estimated_size_ = 0;
+  sqlite3_reset(page_count_stmt_);
+}
 
-  return size;
+VTPL_INLINE std::size_t file_sqllite_helper::estimated_row_size_(const spdlog::details::log_msg& msg)
+{
+  // Text columns plus the record header, the integer columns and the entries
+  // in the default indexes.
+  constexpr std::size_t row_overhead = 64;
+  return msg.payload.size() + msg.logger_name.size() +
+         (msg.source.empty() ? 0 : std::strlen(msg.source.filename)) + row_overhead;
 }
 
 VTPL_INLINE const spdlog::filename_t& file_sqllite_helper::filename() const { return filename_; }
 
+VTPL_INLINE const vtpl::sqllite_options& file_sqllite_helper::options() const { return options_; }
+
 } // namespace details
 } // namespace vtpl
 #endif // file_sqllite_helper_inl_h
@@ -7,13 +7,42 @@
 #define file_sqllite_helper_h
 
 #include "common.h"
+#include "details/rotation_worker.h"
 
+#include <functional>
 #include <spdlog/common.h>
+#include <spdlog/details/log_msg.h>
 #include <sqlite3.h>
+#include <string>
 #include <tuple>
 
 namespace vtpl
 {
+// Storage settings of sqlite log files.
+struct sqllite_options {
+  // Rows inserted per transaction. A flush commits the open transaction early.
+  std::size_t batch_size = 1000;
+  // Value of "PRAGMA journal_mode", e.g. WAL, DELETE, TRUNCATE, MEMORY, OFF. Empty keeps the default.
+  std::string journal_mode = "WAL";
+  // Value of "PRAGMA synchronous", e.g. OFF, NORMAL, FULL. Empty keeps the default.
+  std::string synchronous = "NORMAL";
+  // Secondary indexes of the data table, all off by default: maintaining
+  // data_ts and data_level_ts halves the insert throughput.
+  // data_ts(ts): time range queries.
+  bool index_time = false;
+  // data_level_ts(level, ts): level queries, optionally within a time range.
+  bool index_level = false;
+  // data_source(file, line): queries by source location.
+  bool index_source = false;
+  // Rotate the way background_rotating_file_sink does: under the sink lock the
+  // full database is only renamed and swapped for one prepared in advance; its
+  // WAL checkpoint and the rename cascade run on the rotation_worker thread.
+  bool background_rotation = false;
+  // Compress rotated databases on the rotation_worker thread (log.1.db.gz, ...).
+  // Implies background_rotation.
+  vtpl::rotation_compression compression = vtpl::rotation_compression::none;
+};
+
 struct sqllite_event_handlers {
   sqllite_event_handlers() : before_open(nullptr), after_open(nullptr), before_close(nullptr), after_close(nullptr) {}
 
@@ -27,12 +56,24 @@ namespace details
 
 // Helper class for sqlite file sinks.
 // When failing to open a file, retry several times(5) with a delay interval(10 ms).
+// Every log_msg becomes one row of the table
+//   data(id, ts, level, thread, logger, file, line, msg)
+// where ts is the time in nanoseconds since the epoch, level the spdlog level
+// number and msg the unformatted payload; file and line are NULL when the
+// message carries no source location. Databases written with the older
+// data(id, msg) layout get the missing columns added on open.
+// Rows are inserted through one cached prepared statement, inside explicit
+// transactions committed every options.batch_size rows or on flush().
+// The size of the database is measured as page_count * page_size when a batch
+// is committed; size() adds an estimate of the rows written since, so it never
+// runs a query, and exact_size() measures on demand.
 // Throw spdlog_ex exception on errors.
 class VTPL_API file_sqllite_helper
 {
 public:
   file_sqllite_helper() = default;
-  explicit file_sqllite_helper(const vtpl::sqllite_event_handlers& event_handlers);
+  explicit file_sqllite_helper(const vtpl::sqllite_event_handlers& event_handlers,
+                               vtpl::sqllite_options options = vtpl::sqllite_options());
 
   file_sqllite_helper(const file_sqllite_helper&) = delete;
   file_sqllite_helper& operator=(const file_sqllite_helper&) = delete;
@@ -42,19 +83,44 @@ public:
   void reopen(bool truncate);
   void flush();
   void sync();
-  void close();
-  void write(const spdlog::memory_buf_t& buf);
+  // With checkpoint false, a database in WAL mode keeps its -wal file, so
+  // closing costs no I/O; the next connection to open the file checkpoints it.
+  void close(bool checkpoint = true);
+  void write(const spdlog::details::log_msg& msg);
+  // Size at the last measurement plus the estimated size of the rows written since.
   size_t size() const;
+  // Size of the database including the open transaction, measured now.
+  size_t exact_size();
+  // True if the data table holds no row.
+  bool empty() const;
   const spdlog::filename_t& filename() const;
+  const vtpl::sqllite_options& options() const;
 
 private:
+  void exec_(const char* sql);
+  // Run a query returning a single integer.
+  sqlite3_int64 query_int64_(const char* sql);
+  void create_schema_();
+  void measure_size_();
+  static std::size_t estimated_row_size_(const spdlog::details::log_msg& msg);
+  void begin_();
+  void commit_();
+  [[noreturn]] void throw_sqlite_error_(const std::string& what, int rc);
+
   const int open_tries_ = 5;
   const unsigned int open_interval_ = 10;
-  // sqlite3 *db_{nullptr};
   sqlite3* fd_{nullptr};
-  // std::FILE *fd_{nullptr};
+  sqlite3_stmt* insert_stmt_{nullptr};
+  sqlite3_stmt* page_count_stmt_{nullptr};
+  std::size_t page_size_{0};
+  std::size_t measured_size_{0};
+  std::size_t estimated_size_{0};
+  bool empty_{true};
+  std::size_t rows_in_transaction_{0};
+  bool in_transaction_{false};
   spdlog::filename_t filename_;
   vtpl::sqllite_event_handlers event_handlers_;
+  vtpl::sqllite_options options_;
 };
 } // namespace details
 } // namespace vtpl
@@ -0,0 +1,68 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef periodic_flusher_inl_h
+#define periodic_flusher_inl_h
+#include "common.h"
+
+#ifndef VTPL_HEADER_ONLY
+#include "details/periodic_flusher.h"
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+
+namespace vtpl
+{
+namespace details
+{
+VTPL_INLINE periodic_flusher& periodic_flusher::instance()
+{
+  static auto* flusher = new periodic_flusher();
+  return *flusher;
+}
+
+VTPL_INLINE void periodic_flusher::add(flush_target* target, std::chrono::milliseconds interval)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  targets_.push_back({target, std::max(interval, std::chrono::milliseconds(1))});
+  if (!thread_.joinable()) {
+    thread_ = std::thread([this] { run_(); });
+  }
+  cv_.notify_one();
+}
+
+VTPL_INLINE void periodic_flusher::remove(flush_target* target)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  targets_.erase(std::remove_if(targets_.begin(), targets_.end(),
+                                [target](const entry& e) { return e.target == target; }),
+                 targets_.end());
+}
+
+VTPL_INLINE void periodic_flusher::run_()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    auto tick = std::chrono::milliseconds(1000);
+    for (const auto& e : targets_) {
+      tick = std::min(tick, e.interval);
+    }
+    cv_.wait_for(lock, tick);
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& e : targets_) {
+      try {
+        e.target->flush_if_due(now);
+      } catch (const std::exception& ex) {
+        std::fprintf(stderr, "periodic_flusher: flush failed: %s\n", ex.what());
+      }
+    }
+  }
+}
+
+} // namespace details
+} // namespace vtpl
+#endif // periodic_flusher_inl_h
@@ -0,0 +1,68 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef periodic_flusher_h
+#define periodic_flusher_h
+
+#include "common.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vtpl
+{
+namespace details
+{
+
+// Something the periodic flusher visits on every tick.
+class flush_target
+{
+public:
+  virtual ~flush_target() = default;
+  virtual void flush_if_due(std::chrono::steady_clock::time_point now) = 0;
+};
+
+// A single background thread that lets interval based flush policies flush
+// sinks which have stopped receiving records. The thread is started by the first
+// add() and ticks at the shortest interval registered.
+// The instance is never destroyed, so targets may unregister from static destructors.
+class VTPL_API periodic_flusher
+{
+public:
+  static periodic_flusher& instance();
+
+  periodic_flusher(const periodic_flusher&) = delete;
+  periodic_flusher& operator=(const periodic_flusher&) = delete;
+
+  void add(flush_target* target, std::chrono::milliseconds interval);
+  // After remove() returns the target is not being visited and will not be again.
+  void remove(flush_target* target);
+
+private:
+  periodic_flusher() = default;
+  ~periodic_flusher() = default;
+  void run_();
+
+  struct entry {
+    flush_target* target;
+    std::chrono::milliseconds interval;
+  };
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<entry> targets_;
+  std::thread thread_;
+};
+} // namespace details
+} // namespace vtpl
+
+#ifdef VTPL_HEADER_ONLY
+#include "periodic_flusher-inl.h"
+#endif
+
+#endif // periodic_flusher_h
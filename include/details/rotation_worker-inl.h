@@ -0,0 +1,305 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef rotation_worker_inl_h
+#define rotation_worker_inl_h
+#include "common.h"
+
+#ifndef VTPL_HEADER_ONLY
+#include "details/rotation_worker.h"
+#endif
+
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/os.h>
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+#include <tuple>
+#include <utility>
+
+#ifdef VTPL_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace vtpl
+{
+namespace details
+{
+VTPL_INLINE rotation_worker& rotation_worker::instance()
+{
+  static auto* worker = new rotation_worker();
+  return *worker;
+}
+
+VTPL_INLINE void rotation_worker::post(std::function<void()> task)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  tasks_.push_back(std::move(task));
+  if (!thread_.joinable()) {
+    thread_ = std::thread([this] { run_(); });
+  }
+  cv_.notify_one();
+}
+
+VTPL_INLINE void rotation_worker::wait_idle()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this] { return tasks_.empty() && !busy_; });
+}
+
+VTPL_INLINE spdlog::filename_t rotation_worker::calc_filename(const spdlog::filename_t& filename, std::size_t index)
+{
+  if (index == 0u) {
+    return filename;
+  }
+
+  spdlog::filename_t basename, ext;
+  std::tie(basename, ext) = spdlog::details::file_helper::split_by_extension(filename);
+  return spdlog::fmt_lib::format(SPDLOG_FILENAME_T("{}.{}{}"), basename, index, ext);
+}
+
+VTPL_INLINE spdlog::filename_t rotation_worker::pending_filename(const spdlog::filename_t& filename,
+                                                                 std::size_t sequence)
+{
+  spdlog::filename_t basename, ext;
+  std::tie(basename, ext) = spdlog::details::file_helper::split_by_extension(filename);
+  return spdlog::fmt_lib::format(SPDLOG_FILENAME_T("{}.rotating{}-{}{}"), basename, spdlog::details::os::pid(),
+                                 sequence, ext);
+}
+
+VTPL_INLINE spdlog::filename_t rotation_worker::new_pending_filename(const spdlog::filename_t& filename)
+{
+  static std::atomic<std::size_t> sequence{0};
+  spdlog::filename_t pending;
+  // A file of a dead process with the same pid may still be there.
+  do {
+    pending = pending_filename(filename, sequence.fetch_add(1, std::memory_order_relaxed) + 1);
+  } while (spdlog::details::os::path_exists(pending));
+  return pending;
+}
+
+VTPL_INLINE std::vector<spdlog::filename_t> rotation_worker::leftover_pending_files(const spdlog::filename_t& filename)
+{
+  namespace fs = std::filesystem;
+  using char_type = spdlog::filename_t::value_type;
+
+  spdlog::filename_t basename, ext;
+  std::tie(basename, ext) = spdlog::details::file_helper::split_by_extension(filename);
+  const fs::path base_path(basename);
+  const spdlog::filename_t prefix = base_path.filename().string<char_type>() + SPDLOG_FILENAME_T(".rotating");
+  const spdlog::filename_t own_pid = spdlog::fmt_lib::format(SPDLOG_FILENAME_T("{}"), spdlog::details::os::pid());
+  auto is_number = [](const spdlog::filename_t& text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char_type c) { return c >= '0' && c <= '9'; });
+  };
+
+  std::vector<std::pair<fs::file_time_type, spdlog::filename_t>> leftovers;
+  std::error_code ec;
+  const fs::path dir = base_path.has_parent_path() ? base_path.parent_path() : fs::path(".");
+  for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+    const spdlog::filename_t name = it->path().filename().string<char_type>();
+    if (name.size() <= prefix.size() + ext.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - ext.size(), ext.size(), ext) != 0) {
+      continue;
+    }
+    // "<pid>-<sequence>", or "<sequence>" from versions without the pid.
+    const spdlog::filename_t id = name.substr(prefix.size(), name.size() - prefix.size() - ext.size());
+    const auto dash = id.find(char_type('-'));
+    const bool well_formed = dash == spdlog::filename_t::npos
+                                 ? is_number(id)
+                                 : is_number(id.substr(0, dash)) && is_number(id.substr(dash + 1));
+    if (!well_formed || (dash != spdlog::filename_t::npos && id.substr(0, dash) == own_pid)) {
+      continue;
+    }
+    std::error_code time_ec;
+    leftovers.emplace_back(fs::last_write_time(it->path(), time_ec), it->path().string<char_type>());
+  }
+  std::sort(leftovers.begin(), leftovers.end());
+
+  std::vector<spdlog::filename_t> files;
+  files.reserve(leftovers.size());
+  for (auto& leftover : leftovers) {
+    files.push_back(std::move(leftover.second));
+  }
+  return files;
+}
+
+VTPL_INLINE void rotation_worker::recover_pending_files(const spdlog::filename_t& base_filename, std::size_t max_files,
+                                                        rotation_compression compression)
+{
+  // Listed by the worker, after the tasks of any earlier sink of the same file.
+  post([base_filename, max_files, compression] {
+    for (const auto& leftover : leftover_pending_files(base_filename)) {
+      shift_files(base_filename, leftover, max_files, compression);
+    }
+  });
+}
+
+VTPL_INLINE spdlog::filename_t rotation_worker::next_filename(const spdlog::filename_t& filename)
+{
+  spdlog::filename_t basename, ext;
+  std::tie(basename, ext) = spdlog::details::file_helper::split_by_extension(filename);
+  return spdlog::fmt_lib::format(SPDLOG_FILENAME_T("{}.next{}"), basename, ext);
+}
+
+VTPL_INLINE const spdlog::filename_t::value_type* rotation_worker::compressed_suffix(rotation_compression compression)
+{
+  switch (compression) {
+  case rotation_compression::gzip:
+    return SPDLOG_FILENAME_T(".gz");
+  case rotation_compression::none:
+  default:
+    return SPDLOG_FILENAME_T("");
+  }
+}
+
+VTPL_INLINE bool rotation_worker::compress_file(const spdlog::filename_t& src, const spdlog::filename_t& dst,
+                                                rotation_compression compression)
+{
+  if (compression != rotation_compression::gzip) {
+    return false;
+  }
+#ifdef VTPL_WITH_ZLIB
+  constexpr std::size_t buffer_size = 64 * 1024;
+
+  std::FILE* in = nullptr;
+  if (spdlog::details::os::fopen_s(&in, src, SPDLOG_FILENAME_T("rb"))) {
+    return false;
+  }
+  gzFile out = gzopen(spdlog::details::os::filename_to_str(dst).c_str(), "wb");
+  if (out == nullptr) {
+    std::fclose(in);
+    return false;
+  }
+  gzbuffer(out, buffer_size);
+
+  std::unique_ptr<char[]> buffer(new char[buffer_size]);
+  bool ok = true;
+  std::size_t n = 0;
+  while (ok && (n = std::fread(buffer.get(), 1, buffer_size, in)) > 0) {
+    ok = gzwrite(out, buffer.get(), static_cast<unsigned>(n)) == static_cast<int>(n);
+  }
+  ok = ok && std::ferror(in) == 0;
+  std::fclose(in);
+  ok = gzclose(out) == Z_OK && ok;
+  if (!ok) {
+    (void)spdlog::details::os::remove_if_exists(dst);
+  }
+  return ok;
+#else
+  (void)src;
+  (void)dst;
+  return false;
+#endif
+}
+
+VTPL_INLINE void rotation_worker::shift_files(const spdlog::filename_t& base_filename,
+                                              const spdlog::filename_t& pending, std::size_t max_files,
+                                              rotation_compression compression)
+{
+  using spdlog::details::os::filename_to_str;
+  using spdlog::details::os::path_exists;
+  namespace os = spdlog::details::os;
+
+  // delete the target if exists, and rename the src file to target.
+  auto rename_file = [](const spdlog::filename_t& src, const spdlog::filename_t& target) {
+    (void)os::remove(target);
+    if (os::rename(src, target) == 0) {
+      return true;
+    }
+    // if failed try again after a small delay.
+    // this is a workaround to a windows issue, where very high rotation
+    // rates can cause the rename to fail with permission denied (because of antivirus?).
+    os::sleep_for_millis(100);
+    (void)os::remove(target);
+    return os::rename(src, target) == 0;
+  };
+
+  const spdlog::filename_t suffix = compressed_suffix(compression);
+  spdlog::filename_t rotated = pending;
+  if (max_files > 0 && !suffix.empty() && path_exists(pending)) {
+    if (compress_file(pending, pending + suffix, compression)) {
+      (void)os::remove(pending);
+      rotated = pending + suffix;
+    } else {
+      std::fprintf(stderr, "rotation_worker: failed compressing %s, keeping it uncompressed\n",
+                   filename_to_str(pending).c_str());
+    }
+  }
+
+  // Every index holds a plain file, a compressed one, or none.
+  const spdlog::filename_t variants[] = {compressed_suffix(rotation_compression::none),
+                                         compressed_suffix(rotation_compression::gzip)};
+  for (auto i = max_files; i > 0; --i) {
+    for (const auto& variant : variants) {
+      spdlog::filename_t src;
+      if (i == 1) {
+        if (rotated != pending + variant) {
+          continue;
+        }
+        src = rotated;
+      } else {
+        src = calc_filename(base_filename, i - 1) + variant;
+      }
+      if (!path_exists(src)) {
+        continue;
+      }
+      const spdlog::filename_t target = calc_filename(base_filename, i) + variant;
+      for (const auto& other : variants) {
+        if (other != variant) {
+          (void)os::remove_if_exists(calc_filename(base_filename, i) + other);
+        }
+      }
+      if (!rename_file(src, target)) {
+        std::fprintf(stderr, "rotation_worker: failed renaming %s to %s\n", filename_to_str(src).c_str(),
+                     filename_to_str(target).c_str());
+      }
+    }
+  }
+  // Still there when max_files is 0 or its rename failed: the file must not pile up.
+  (void)os::remove_if_exists(pending);
+  (void)os::remove_if_exists(rotated);
+}
+
+VTPL_INLINE void rotation_worker::run_()
+{
+#ifdef __linux__
+  // Linux applies nice values per thread.
+  (void)setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    cv_.wait(lock, [this] { return !tasks_.empty(); });
+    auto task = std::move(tasks_.front());
+    tasks_.pop_front();
+    busy_ = true;
+    lock.unlock();
+    try {
+      task();
+    } catch (const std::exception& ex) {
+      std::fprintf(stderr, "rotation_worker: task failed: %s\n", ex.what());
+    }
+    lock.lock();
+    busy_ = false;
+    if (tasks_.empty()) {
+      idle_cv_.notify_all();
+    }
+  }
+}
+
+} // namespace details
+} // namespace vtpl
+#endif // rotation_worker_inl_h
@@ -0,0 +1,111 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef rotation_worker_h
+#define rotation_worker_h
+
+#include "common.h"
+
+#include <spdlog/common.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vtpl
+{
+// How rotated log files are stored. gzip needs the library built with zlib
+// (VTPL_WITH_ZLIB); without it rotated files are left uncompressed.
+enum class rotation_compression
+{
+  none,
+  gzip
+};
+
+namespace details
+{
+
+// A single background thread doing the slow part of log rotation for sinks in
+// background rotation mode: compression, the rename cascade, deleting the
+// oldest file, retries, and creating the file the sink switches to on its next
+// rotation. Tasks run one at a time in the order they were posted, on a thread
+// with a lowered scheduling priority (nice 10 on Linux), so compression takes
+// at most one core and yields it to the logging threads.
+// The instance is never destroyed, so sinks may post from static destructors.
+class VTPL_API rotation_worker
+{
+public:
+  static rotation_worker& instance();
+
+  rotation_worker(const rotation_worker&) = delete;
+  rotation_worker& operator=(const rotation_worker&) = delete;
+
+  void post(std::function<void()> task);
+  // Block until every task posted before this call has run.
+  void wait_idle();
+
+  // calc_filename("logs/mylog.txt", 3) => "logs/mylog.3.txt", index 0 is the file itself.
+  static spdlog::filename_t calc_filename(const spdlog::filename_t& filename, std::size_t index);
+  // Name of the file a sink moves its full file to before handing it to shift_files(),
+  // made unique by the pid and a sequence number.
+  // e.g. pending_filename("logs/mylog.txt", 7) => "logs/mylog.rotating1234-7.txt" in process 1234.
+  static spdlog::filename_t pending_filename(const spdlog::filename_t& filename, std::size_t sequence);
+  // A pending_filename() that no file has yet, numbered by a counter shared by every
+  // sink of the process, so sinks never take each other's pending files.
+  static spdlog::filename_t new_pending_filename(const spdlog::filename_t& filename);
+  // Pending files of `filename` left by other processes, which died before their
+  // rotation finished, oldest first. Pending files of this process are its own
+  // sinks' and are not listed.
+  static std::vector<spdlog::filename_t> leftover_pending_files(const spdlog::filename_t& filename);
+  // Post shift_files() of every leftover pending file, so they take their place in
+  // the rotation instead of piling up. Sinks call it before their first rotation.
+  void recover_pending_files(const spdlog::filename_t& base_filename, std::size_t max_files,
+                             rotation_compression compression = rotation_compression::none);
+  // Name of the empty file prepared for the next rotation.
+  // e.g. next_filename("logs/mylog.txt") => "logs/mylog.next.txt".
+  static spdlog::filename_t next_filename(const spdlog::filename_t& filename);
+
+  // File name suffix of a compressed rotated file, e.g. ".gz".
+  static const spdlog::filename_t::value_type* compressed_suffix(rotation_compression compression);
+
+  // Compress src into dst, streaming through a fixed size buffer.
+  // Returns false, leaving no dst behind, if that fails or is not supported.
+  static bool compress_file(const spdlog::filename_t& src, const spdlog::filename_t& dst,
+                            rotation_compression compression);
+
+  // The cascade of a blocking rotation, for a full file already moved to `pending`:
+  // log.2.txt -> log.3.txt, log.1.txt -> log.2.txt, pending -> log.1.txt,
+  // dropping the file pushed past max_files. With compression, pending is
+  // compressed first and the cascade becomes log.1.txt.gz -> log.2.txt.gz ...;
+  // an index holds either the plain or the compressed file, whichever is
+  // there, so files rotated with another setting keep their place.
+  // A failed rename is retried once after 100 ms; errors are reported to stderr.
+  static void shift_files(const spdlog::filename_t& base_filename, const spdlog::filename_t& pending,
+                          std::size_t max_files, rotation_compression compression = rotation_compression::none);
+
+private:
+  rotation_worker() = default;
+  ~rotation_worker() = default;
+  void run_();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::function<void()>> tasks_;
+  bool busy_{false};
+  std::thread thread_;
+};
+} // namespace details
+} // namespace vtpl
+
+#ifdef VTPL_HEADER_ONLY
+#include "rotation_worker-inl.h"
+#endif
+
+#endif // rotation_worker_h
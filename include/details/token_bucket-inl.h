@@ -0,0 +1,54 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef token_bucket_inl_h
+#define token_bucket_inl_h
+#include "common.h"
+
+#ifndef VTPL_HEADER_ONLY
+#include "details/token_bucket.h"
+#endif
+
+#include <algorithm>
+
+namespace vtpl
+{
+namespace details
+{
+VTPL_INLINE token_bucket::token_bucket(double rate, double burst)
+    : rate_(rate), burst_(std::max(burst, 1.0)), tokens_(burst_), last_(std::chrono::steady_clock::now())
+{
+}
+
+VTPL_INLINE void token_bucket::set_rate(double rate, double burst)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  burst_ = std::max(burst, 1.0);
+  tokens_ = burst_;
+  last_ = std::chrono::steady_clock::now();
+  rate_.store(rate, std::memory_order_relaxed);
+}
+
+VTPL_INLINE bool token_bucket::try_take(std::chrono::steady_clock::time_point now)
+{
+  if (!enabled()) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (now > last_) {
+    const double elapsed = std::chrono::duration<double>(now - last_).count();
+    tokens_ = std::min(burst_, tokens_ + elapsed * rate_.load(std::memory_order_relaxed));
+    last_ = now;
+  }
+  if (tokens_ < 1) {
+    return false;
+  }
+  tokens_ -= 1;
+  return true;
+}
+
+} // namespace details
+} // namespace vtpl
+#endif // token_bucket_inl_h
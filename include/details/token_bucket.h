@@ -0,0 +1,52 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef token_bucket_h
+#define token_bucket_h
+
+#include "common.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace vtpl
+{
+namespace details
+{
+
+// Admits `rate` events per second on average and up to `burst` at once after
+// an idle period. A rate <= 0 admits everything without locking.
+// Thread safe; may be shared by several sinks to limit them together.
+class VTPL_API token_bucket
+{
+public:
+  token_bucket(double rate = 0, double burst = 1);
+
+  token_bucket(const token_bucket&) = delete;
+  token_bucket& operator=(const token_bucket&) = delete;
+
+  // Change the limit; the bucket starts full.
+  void set_rate(double rate, double burst);
+  bool enabled() const { return rate_.load(std::memory_order_relaxed) > 0; }
+
+  // Take a token if one is left at `now`.
+  bool try_take(std::chrono::steady_clock::time_point now);
+
+private:
+  std::mutex mutex_;
+  std::atomic<double> rate_;
+  double burst_;
+  double tokens_;
+  std::chrono::steady_clock::time_point last_;
+};
+} // namespace details
+} // namespace vtpl
+
+#ifdef VTPL_HEADER_ONLY
+#include "token_bucket-inl.h"
+#endif
+
+#endif // token_bucket_h
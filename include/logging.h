@@ -3,6 +3,7 @@
 // #include <gtest/gtest_prod.h>
 #include <atomic>
 #include <chrono> // chrono::system_clock
+#include <cstdint>
 #include <ctime>  // localtime
 #include <fmt/core.h>
 #include <functional>
@@ -12,6 +13,7 @@
 #include <spdlog/logger.h>
 #include <sstream> // stringstream
 #include <string>  // string
+#include <string_view>
 #include <vector>
 
 #include <core_export.h>
@@ -48,13 +50,51 @@ std::string GetCallTrace();
 
 enum class RayLogLevel { TRACE = -2, DEBUG = -1, INFO = 0, WARNING = 1, ERROR = 2, FATAL = 3 };
 
-#define RAY_LOG_INTERNAL(level) ::ray::RayLog(__FILE__, __LINE__, level)
+/// Values of RAY_LOG_ACTIVE_LEVEL, equal to the RayLogLevel enumerators.
+#define RAY_LOG_LEVEL_TRACE   (-2)
+#define RAY_LOG_LEVEL_DEBUG   (-1)
+#define RAY_LOG_LEVEL_INFO    0
+#define RAY_LOG_LEVEL_WARNING 1
+#define RAY_LOG_LEVEL_ERROR   2
+#define RAY_LOG_LEVEL_FATAL   3
+
+#ifndef RAY_LOG_ACTIVE_LEVEL
+/// Lowest level compiled in: RAY_LOG statements below it, and their strings, are
+/// removed at compile time whatever the threshold. Set by the RAY_LOG_ACTIVE_LEVEL
+/// CMake option. FATAL statements are always kept.
+#define RAY_LOG_ACTIVE_LEVEL RAY_LOG_LEVEL_TRACE
+#endif
+
+/// True if statements of `level` are compiled in, a constant expression.
+#define RAY_LOG_LEVEL_ACTIVE(level)                                                                                    \
+  (::ray::RayLogLevel::level == ::ray::RayLogLevel::FATAL ||                                                           \
+   static_cast<int>(::ray::RayLogLevel::level) >= RAY_LOG_ACTIVE_LEVEL)
 
-#define RAY_LOG_ENABLED(level) ray::RayLog::IsLevelEnabled(ray::RayLogLevel::level)
+/// True if `level` is compiled in and not below the threshold.
+#define RAY_LOG_LEVEL_ENABLED(level)                                                                                   \
+  (RAY_LOG_LEVEL_ACTIVE(level) && ::ray::RayLog::IsLevelEnabled(::ray::RayLogLevel::level))
+
+#ifndef RAY_LOG_MODULE
+/// Module tag of the RAY_LOG sites of a translation unit, matched by the level spec
+/// (see RayLog::SetLogLevelSpec). Define it before including this header, or for a
+/// whole target with target_compile_definitions.
+#define RAY_LOG_MODULE ""
+#endif
+
+/// The descriptor of this call site, a constant initialised static.
+#define RAY_LOG_SITE(level)                                                                                            \
+  ([]() -> ::ray::RayLogSite& {                                                                                        \
+    static ::ray::RayLogSite site(__FILE__, __LINE__, RAY_LOG_MODULE, ::ray::RayLogLevel::level);                      \
+    return site;                                                                                                       \
+  }())
+
+#define RAY_LOG_ENABLED(level) (RAY_LOG_LEVEL_ACTIVE(level) && RAY_LOG_SITE(level).IsEnabled())
 
 #define RAY_LOG(level)                                                                                                 \
-  if (ray::RayLog::IsLevelEnabled(ray::RayLogLevel::level))                                                            \
-  RAY_LOG_INTERNAL(ray::RayLogLevel::level)
+  if constexpr (!RAY_LOG_LEVEL_ACTIVE(level)) {                                                                        \
+  } else if (::ray::RayLogSite& ray_log_site = RAY_LOG_SITE(level); !ray_log_site.IsEnabled()) {                       \
+  } else                                                                                                               \
+    ::ray::RayLog(ray_log_site)
 
 #define RAY_LOG_TRC RAY_LOG(TRACE)
 #define RAY_LOG_DBG RAY_LOG(DEBUG)
@@ -67,15 +107,13 @@ enum class RayLogLevel { TRACE = -2, DEBUG = -1, INFO = 0, WARNING = 1, ERROR =
 
 #define RAY_CHECK(condition)                                                                                           \
   (condition) ? RAY_IGNORE_EXPR(0)                                                                                     \
-              : ::ray::Voidify() & ::ray::RayLog(__FILE__, __LINE__, ray::RayLogLevel::FATAL)                          \
-                                       << " Check failed: " #condition " "
+              : ::ray::Voidify() & ::ray::RayLog(RAY_LOG_SITE(FATAL)) << " Check failed: " #condition " "
 
 #ifdef NDEBUG
 
 #define RAY_DCHECK(condition)                                                                                          \
   (condition) ? RAY_IGNORE_EXPR(0)                                                                                     \
-              : ::ray::Voidify() & ::ray::RayLog(__FILE__, __LINE__, ray::RayLogLevel::ERROR)                          \
-                                       << " Debug check failed: " #condition " "
+              : ::ray::Voidify() & ::ray::RayLog(RAY_LOG_SITE(ERROR)) << " Debug check failed: " #condition " "
 #else
 
 #define RAY_DCHECK(condition) RAY_CHECK(condition)
@@ -89,41 +127,66 @@ enum class RayLogLevel { TRACE = -2, DEBUG = -1, INFO = 0, WARNING = 1, ERROR =
 
 #define RAY_LOG_OCCURRENCES RAY_LOG_EVERY_N_VARNAME(occurrences_, __LINE__)
 
-// Occasional logging, log every n'th occurrence of an event.
+// Occasional logging, log every n'th occurrence of an event. Only occurrences at
+// an enabled site are counted.
 #define RAY_LOG_EVERY_N(level, n)                                                                                      \
   static std::atomic<uint64_t> RAY_LOG_OCCURRENCES(0);                                                                 \
-  if (ray::RayLog::IsLevelEnabled(ray::RayLogLevel::level) && RAY_LOG_OCCURRENCES.fetch_add(1) % n == 0)               \
-  RAY_LOG_INTERNAL(ray::RayLogLevel::level) << "[" << RAY_LOG_OCCURRENCES << "] "
+  if constexpr (!RAY_LOG_LEVEL_ACTIVE(level)) {                                                                        \
+  } else if (::ray::RayLogSite& ray_log_site = RAY_LOG_SITE(level);                                                    \
+             ray_log_site.IsEnabled() && RAY_LOG_OCCURRENCES.fetch_add(1) % n == 0)                                    \
+    ::ray::RayLog(ray_log_site) << "[" << RAY_LOG_OCCURRENCES << "] "
 
 // Occasional logging with DEBUG fallback:
 // If DEBUG is not enabled, log every n'th occurrence of an event.
 // Otherwise, if DEBUG is enabled, always log as DEBUG events.
+// Both levels are checked at sites of their own, so the level spec applies to each.
 #define RAY_LOG_EVERY_N_OR_DEBUG(level, n)                                                                             \
   static std::atomic<uint64_t> RAY_LOG_OCCURRENCES(0);                                                                 \
-  if (ray::RayLog::IsLevelEnabled(ray::RayLogLevel::DEBUG) ||                                                          \
-      (ray::RayLog::IsLevelEnabled(ray::RayLogLevel::level) && RAY_LOG_OCCURRENCES.fetch_add(1) % n == 0))             \
-  RAY_LOG_INTERNAL(ray::RayLog::IsLevelEnabled(ray::RayLogLevel::level) ? ray::RayLogLevel::level                      \
-                                                                        : ray::RayLogLevel::DEBUG)                     \
-      << "[" << RAY_LOG_OCCURRENCES << "] "
+  if (::ray::RayLogSite* ray_log_site = [&]() -> ::ray::RayLogSite* {                                                  \
+        ::ray::RayLogSite& level_site = RAY_LOG_SITE(level);                                                           \
+        ::ray::RayLogSite& debug_site = RAY_LOG_SITE(DEBUG);                                                           \
+        const bool         enabled    = RAY_LOG_LEVEL_ACTIVE(level) && level_site.IsEnabled();                         \
+        const bool         debug      = RAY_LOG_LEVEL_ACTIVE(DEBUG) && debug_site.IsEnabled();                         \
+        if (!debug && !(enabled && RAY_LOG_OCCURRENCES.fetch_add(1) % n == 0)) {                                       \
+          return nullptr;                                                                                              \
+        }                                                                                                              \
+        return enabled ? &level_site : &debug_site;                                                                    \
+      }())                                                                                                             \
+  ::ray::RayLog(*ray_log_site) << "[" << RAY_LOG_OCCURRENCES << "] "
+
+/// Monotonic time for rate limited logging. On Linux it is CLOCK_MONOTONIC_COARSE,
+/// read from the vDSO without a system call and with the resolution of the
+/// scheduler tick (1-10 ms), so periods are rounded to that.
+inline std::chrono::nanoseconds CoarseSteadyNow() {
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+  return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+#else
+  return std::chrono::steady_clock::now().time_since_epoch();
+#endif
+}
+
+/// True if more than `period` passed since `last`, the time this last returned true.
+/// When several threads see the period elapse, only the one updating `last` wins.
+inline bool RayLogPeriodElapsed(std::atomic<int64_t>& last, std::chrono::nanoseconds period) {
+  const int64_t now      = CoarseSteadyNow().count();
+  int64_t       previous = last.load(std::memory_order_relaxed);
+  return now - previous > period.count() && last.compare_exchange_strong(previous, now, std::memory_order_relaxed);
+}
 
 /// Macros for RAY_LOG_EVERY_MS
-#define RAY_LOG_TIME_PERIOD       RAY_LOG_EVERY_N_VARNAME(timePeriod_, __LINE__)
 #define RAY_LOG_PREVIOUS_TIME_RAW RAY_LOG_EVERY_N_VARNAME(previousTimeRaw_, __LINE__)
-#define RAY_LOG_TIME_DELTA        RAY_LOG_EVERY_N_VARNAME(deltaTime_, __LINE__)
-#define RAY_LOG_CURRENT_TIME      RAY_LOG_EVERY_N_VARNAME(currentTime_, __LINE__)
-#define RAY_LOG_PREVIOUS_TIME     RAY_LOG_EVERY_N_VARNAME(previousTime_, __LINE__)
 
+// Rate limited logging, log at most once every `ms` milliseconds. The clock is
+// only read when the site is enabled.
 #define RAY_LOG_EVERY_MS(level, ms)                                                                                    \
-  constexpr std::chrono::milliseconds  RAY_LOG_TIME_PERIOD(ms);                                                        \
-  static std::atomic<int64_t>          RAY_LOG_PREVIOUS_TIME_RAW;                                                      \
-  const auto                           RAY_LOG_CURRENT_TIME = std::chrono::steady_clock::now().time_since_epoch();     \
-  const decltype(RAY_LOG_CURRENT_TIME) RAY_LOG_PREVIOUS_TIME(                                                          \
-      RAY_LOG_PREVIOUS_TIME_RAW.load(std::memory_order_relaxed));                                                      \
-  const auto RAY_LOG_TIME_DELTA = RAY_LOG_CURRENT_TIME - RAY_LOG_PREVIOUS_TIME;                                        \
-  if (RAY_LOG_TIME_DELTA > RAY_LOG_TIME_PERIOD)                                                                        \
-    RAY_LOG_PREVIOUS_TIME_RAW.store(RAY_LOG_CURRENT_TIME.count(), std::memory_order_relaxed);                          \
-  if (ray::RayLog::IsLevelEnabled(ray::RayLogLevel::level) && RAY_LOG_TIME_DELTA > RAY_LOG_TIME_PERIOD)                \
-  RAY_LOG_INTERNAL(ray::RayLogLevel::level)
+  static std::atomic<int64_t> RAY_LOG_PREVIOUS_TIME_RAW(0);                                                            \
+  if constexpr (!RAY_LOG_LEVEL_ACTIVE(level)) {                                                                        \
+  } else if (::ray::RayLogSite& ray_log_site = RAY_LOG_SITE(level);                                                    \
+             ray_log_site.IsEnabled() &&                                                                               \
+             ::ray::RayLogPeriodElapsed(RAY_LOG_PREVIOUS_TIME_RAW, std::chrono::milliseconds(ms)))                     \
+    ::ray::RayLog(ray_log_site)
 
 // To make the logging lib plugable with other logging libs and make
 // the implementation unawared by the user, RayLog is only a declaration
@@ -156,15 +219,166 @@ protected:
   virtual std::ostream& ExposeStream() { return std::cerr; };
 };
 
+/// What an asynchronous RayLog does with a new record when its queue is full.
+enum class RayLogOverflowPolicy {
+  /// Wait until the writer thread frees a slot.
+  BLOCK = 0,
+  /// Discard the new record.
+  DROP_NEWEST = 1,
+  /// Discard the oldest queued record to make room for the new one.
+  DROP_OLDEST = 2
+};
+
+/// Options of the asynchronous RayLog backend, see RayLog::StartRayLog.
+struct RayLogAsyncOptions {
+  /// Hand records to a dedicated writer thread instead of writing them on the calling thread.
+  bool enabled = false;
+  /// Number of records the queue can hold, rounded up to a power of two.
+  size_t queue_size = 8192;
+  /// Behaviour when the queue is full.
+  RayLogOverflowPolicy overflow_policy = RayLogOverflowPolicy::BLOCK;
+};
+
+/// When buffered log output is handed to the operating system. A record
+/// triggers a flush if any enabled condition holds; an idle logger is flushed by
+/// a background thread once `interval` has passed since its last flush.
+struct RayLogFlushPolicy {
+  /// Flush after every record at or above this level. ERROR and FATAL are always
+  /// flushed, so a higher value is lowered to ERROR.
+  RayLogLevel level = RayLogLevel::ERROR;
+  /// Flush once this many payload bytes were written since the last flush. 0 disables.
+  size_t bytes = 0;
+  /// Longest time a record may stay buffered. 0 disables.
+  std::chrono::milliseconds interval{1000};
+};
+
+/// Limits that keep a log storm, e.g. the same ERROR from every channel on every
+/// frame, from rotating the useful history out of the log files. FATAL records
+/// are never held back. Zero rates and windows disable that part.
+struct RayLogRateLimit {
+  /// Records per second a logger may write on average. Dropped records are
+  /// reported as "N records dropped by the rate limit" before the next one written.
+  double rate = 0;
+  /// Records a logger may write at once after being quiet.
+  size_t burst = 200;
+  /// Records per second all loggers of StartRayLog and get_logger_st may write together.
+  /// Only StartRayLog reads it.
+  double global_rate = 0;
+  size_t global_burst = 1000;
+  /// A record equal to one of the same logger and call site seen less than this ago
+  /// is only counted, and reported as "last message repeated N times" afterwards.
+  std::chrono::milliseconds duplicate_window{0};
+};
+
 /// Callback function which will be triggered to expose fatal log.
 /// The first argument: a string representing log type or label.
 /// The second argument: log content.
 using FatalLogCallback = std::function<void(const std::string&, const std::string&)>;
 
+struct RayLogState;
+
+/// One RAY_LOG call site. The first time a site runs it registers itself, and
+/// from then on its flag follows the level spec and the threshold, so checking it
+/// costs one relaxed load.
+/// The "file.cc:123: " prefix of its records is computed at compile time, and
+/// registration gives the site an id; sinks see the site as the source location
+/// of its records, with the basename as file name.
+class CORE_EXPORT RayLogSite {
+public:
+  constexpr RayLogSite(const char* file, int line, const char* module, RayLogLevel level)
+      : file_(file), line_(line), module_(module), level_(level), basename_(file) {
+    for (const char* it = file; *it != '\0'; ++it) {
+#ifdef _WIN32
+      if (*it == '\\') {
+        basename_ = it + 1;
+      }
+#endif
+      if (*it == '/') {
+        basename_ = it + 1;
+      }
+    }
+    char digits[10]{};
+    int  count = 0;
+    auto value = static_cast<unsigned>(line > 0 ? line : 0);
+    do {
+      digits[count++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+    line_text_[line_text_size_++] = ':';
+    while (count > 0) {
+      line_text_[line_text_size_++] = digits[--count];
+    }
+    line_text_[line_text_size_++] = ':';
+    line_text_[line_text_size_++] = ' ';
+  }
+
+  RayLogSite(const RayLogSite&)            = delete;
+  RayLogSite& operator=(const RayLogSite&) = delete;
+
+  bool IsEnabled() {
+    const int8_t state = state_.load(std::memory_order_relaxed);
+    return state >= 0 ? state != 0 : Register();
+  }
+
+  const char* File() const { return file_; }
+  int         Line() const { return line_; }
+  const char* Module() const { return module_; }
+  RayLogLevel Level() const { return level_; }
+  /// The file name without its directories.
+  const char* Basename() const { return basename_; }
+  /// ":<line>: ", what follows the basename in the prefix of a record.
+  std::string_view LineText() const { return {line_text_, line_text_size_}; }
+
+  /// Count one record written from the site, see RayLog::GetLogSiteCounts.
+  void AddRecord() { records_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+  friend class RayLog;
+
+  /// Add the site to the registry and resolve it. \return IsEnabled().
+  bool Register();
+  /// Recompute the flag; the registry lock is held.
+  void Resolve();
+  /// Resolve every registered site, after the threshold or the spec changed.
+  static void ResolveAll();
+
+  const char* file_;
+  int         line_;
+  const char* module_;
+  RayLogLevel level_;
+  const char* basename_;
+  char        line_text_[16]{};
+  size_t      line_text_size_{0};
+  /// Assigned by Register(), from 1 in registration order; read under the registry lock.
+  uint32_t id_{0};
+  /// -1 until registered, then 1 if enabled and 0 if not.
+  std::atomic<int8_t>   state_{-1};
+  std::atomic<uint64_t> records_{0};
+};
+
+/// Records written from one RAY_LOG site, see RayLog::GetLogSiteCounts.
+struct RayLogSiteCount {
+  uint32_t    id;
+  const char* file;
+  int         line;
+  const char* module;
+  RayLogLevel level;
+  uint64_t    records;
+};
+
 class CORE_EXPORT RayLog : public RayLogBase {
 public:
+  /// For code that logs without the macros. Every record builds its site again,
+  /// follows only the threshold and is not counted by GetLogSiteCounts; the macros
+  /// use a static RAY_LOG_SITE instead.
   RayLog(const char* file_name, int line_number, RayLogLevel severity);
 
+  /// As above, for callers that already checked the level.
+  RayLog(const char* file_name, int line_number, RayLogLevel severity, bool is_enabled);
+
+  /// A record of `site`, or a null one if the site is disabled.
+  explicit RayLog(RayLogSite& site);
+
   virtual ~RayLog();
 
   /// Return whether or not current logging instance is enabled.
@@ -179,10 +393,29 @@ public:
   /// \parem appName The app name which starts the log.
   /// \param severity_threshold Logging threshold for the program.
   /// \param logDir Logging output file name. If empty, the log won't output to file.
+  /// The file is rotated by size (RAY_ROTATION_MAX_BYTES, RAY_ROTATION_BACKUP_COUNT) on a
+  /// background thread, unless RAY_ROTATION_IN_BACKGROUND is set to 0. RAY_ROTATION_COMPRESSION=gzip
+  /// compresses the rotated files there too. With RAY_BACKEND_LOG_BINARY=1 the file is written
+  /// in the compact binary format instead (<app>_<pid>.blog), read back with binary_log_decoder.
+  /// The last records are also kept in <app>_<pid>.crash, a memory-mapped ring that is on disk
+  /// even after a crash; RAY_BACKEND_LOG_CRASH_RING_BYTES sets its size (1 MiB, 0 disables).
+  /// binary_log_decoder prints it too.
+  /// \param async_options Write records from a background thread. Overridden by the
+  /// RAY_BACKEND_LOG_ASYNC, RAY_BACKEND_LOG_QUEUE_SIZE and RAY_BACKEND_LOG_OVERFLOW_POLICY
+  /// environment variables. FATAL records are always written synchronously.
+  /// \param flush_policy When the log is flushed. Overridden by the RAY_BACKEND_LOG_FLUSH_LEVEL,
+  /// RAY_BACKEND_LOG_FLUSH_BYTES and RAY_BACKEND_LOG_FLUSH_INTERVAL_MS environment variables.
+  /// \param rate_limit Protection against log storms. Overridden by the RAY_BACKEND_LOG_RATE_LIMIT,
+  /// RAY_BACKEND_LOG_RATE_BURST, RAY_BACKEND_LOG_GLOBAL_RATE_LIMIT and
+  /// RAY_BACKEND_LOG_DUPLICATE_WINDOW_MS environment variables.
   static void StartRayLog(const std::string& app_name, RayLogLevel severity_threshold = RayLogLevel::INFO,
-                          const std::string& log_dir = "", bool use_pid = true);
+                          const std::string& log_dir = "", bool use_pid = true,
+                          RayLogAsyncOptions async_options = RayLogAsyncOptions(),
+                          RayLogFlushPolicy  flush_policy  = RayLogFlushPolicy(),
+                          RayLogRateLimit    rate_limit    = RayLogRateLimit());
 
   /// The shutdown function of ray log which should be used with StartRayLog as a pair.
+  /// No other thread may be logging while it runs.
   static void ShutDownRayLog();
 
   /// Uninstall the signal actions installed by InstallFailureSignalHandler.
@@ -192,9 +425,40 @@ public:
   ///
   /// \param log_level The input log level to test.
   /// \return True if input log level is not lower than the threshold.
-  static bool IsLevelEnabled(RayLogLevel log_level);
+  static bool IsLevelEnabled(RayLogLevel log_level) {
+    return log_level >= severity_threshold_.load(std::memory_order_relaxed);
+  }
+
+  /// Change the threshold of RAY_LOG while the program runs.
+  static void SetLogLevel(RayLogLevel log_level);
+
+  /// Give some RAY_LOG sites their own threshold, e.g. "decoder=debug,*/net/*.cpp=trace".
+  /// Each comma separated rule is a glob, where * matches any characters and ? one,
+  /// and a level; it applies to the sites whose RAY_LOG_MODULE, source file path or
+  /// file name it matches. The last matching rule wins; other sites use the threshold.
+  /// StartRayLog applies RAY_BACKEND_LOG_LEVEL_SPEC, and a log level file its
+  /// [RayLog] spec entry. FATAL is never filtered.
+  ///
+  /// \return False if a rule could not be parsed; the other rules are applied.
+  static bool SetLogLevelSpec(const std::string& spec);
 
-  /// Install the failure signal handler to output call stack when crash.
+  /// Apply the log levels in a ConfigFile format file now and whenever it changes:
+  ///
+  ///   [RayLog]
+  ///   level = debug
+  ///   spec = decoder=trace
+  ///   [loggers]
+  ///   cam_3_1 = trace
+  ///
+  /// `level` is the RAY_LOG threshold and `spec` a level spec as taken by SetLogLevelSpec.
+  /// Each [loggers] entry sets the level of the spdlog logger of that name, e.g. one
+  /// returned by get_logger_st, and may be trace, debug, info, warning, error, fatal
+  /// or off. Missing entries are left as they are.
+  /// StartRayLog watches the file named by RAY_BACKEND_LOG_LEVEL_FILE.
+  static void WatchLogLevelFile(const std::string& path);
+
+  /// Install a handler for SIGSEGV, SIGILL, SIGFPE, SIGABRT and SIGTERM that reports the
+  /// signal on stderr and in the crash ring, then lets the default action end the process.
   static void InstallFailureSignalHandler();
 
   /// To check failure signal handler enabled or not.
@@ -205,8 +469,28 @@ public:
 
   static std::string GetLogFormatPattern();
 
+  /// Change the spdlog pattern of RAY_LOG records, also for the logger already in use.
+  static void SetLogFormatPattern(const std::string& pattern);
+
   static std::string GetLoggerName();
 
+  /// Return the logger RAY_LOG writes to, as published by StartRayLog.
+  ///
+  /// \return The cached logger handle, or nullptr if logging is not started.
+  static spdlog::logger* GetLogger();
+
+  /// Get the number of records dropped by the asynchronous backend's overflow policy.
+  static uint64_t GetDroppedLogCount();
+
+  /// Get the number of records dropped by a rate limit, see RayLogRateLimit.
+  static uint64_t GetRateLimitedLogCount();
+
+  /// Get the number of records suppressed as repetitions, see RayLogRateLimit.
+  static uint64_t GetDuplicateLogCount();
+
+  /// Number of records written from each RAY_LOG and RAY_LOGF site that ran so far, by site id.
+  static std::vector<RayLogSiteCount> GetLogSiteCounts();
+
   /// Add callback functions that will be triggered to expose fatal log.
   static void AddFatalLogCallbacks(const std::vector<FatalLogCallback>& expose_log_callbacks);
 
@@ -224,9 +508,10 @@ private:
   bool is_fatal_ = false;
   /// String stream of exposed log content.
   std::shared_ptr<std::ostringstream> expose_osstream_ = nullptr;
-  /// Callback functions which will be triggered to expose fatal log.
-  static std::vector<FatalLogCallback> fatal_log_callbacks_;
-  static RayLogLevel                   severity_threshold_;
+  /// The current configuration; see RayLogState.
+  static std::atomic<const RayLogState*> state_;
+  /// Copy of the threshold of state_, so checking a level is a single relaxed load.
+  static std::atomic<RayLogLevel>        severity_threshold_;
   // In InitGoogleLogging, it simply keeps the pointer.
   // We need to make sure the app name passed to InitGoogleLogging exist.
   static std::string app_name_;
@@ -236,14 +521,27 @@ private:
   /// This flag is used to avoid calling UninstallSignalAction in ShutDownRayLog if
   /// InstallFailureSignalHandler was not called.
   static bool is_failure_signal_handler_installed_;
-  // Log format content.
-  static std::string log_format_pattern_;
   // Log rotation file size limitation.
   static uint64_t log_rotation_max_size_;
   // Log rotation file number.
   static int64_t log_rotation_file_num_;
-  // Ray default logger name.
-  static std::string logger_name_;
+  // File passed to WatchLogLevelFile, unwatched by ShutDownRayLog.
+  static std::string log_level_file_;
+
+  friend class RayLogSite;
+
+  RayLog(const RayLogSite& site, RayLogLevel severity, bool is_enabled);
+
+  /// The current configuration. It stays valid until ShutDownRayLog, however long it is used.
+  static const RayLogState& State();
+  /// Publish a copy of the configuration changed by `update`. Writers are serialised.
+  static void UpdateState(const std::function<void(RayLogState&)>& update);
+  /// Free the snapshots UpdateState replaced, with the loggers only they hold.
+  /// No thread may be logging.
+  static void FreeRetiredStates();
+
+  /// Make `logger` the target of RAY_LOG. nullptr falls back to stderr.
+  static void PublishLogger(std::shared_ptr<spdlog::logger> logger);
 
 protected:
   virtual std::ostream& Stream();
@@ -264,9 +562,16 @@ public:
 std::string CORE_EXPORT printable_git_info_safe(const std::string& git_details);
 std::string CORE_EXPORT printable_git_info(const std::string& git_details);
 
+/// Return the logger of a channel, writing <session_folder>/<logger name>.log, or
+/// nullptr if <session_folder>/<base_name>.cnf disables it. The .cnf is watched:
+/// setting an entry to 0 or back to 1 turns loggers already created off or on.
 std::shared_ptr<spdlog::logger> CORE_EXPORT get_logger_st(const std::string& session_folder,
                                                           const std::string& base_name, int16_t channel_id = 0,
                                                           int16_t app_id = 0);
+/// Set the flush policy of loggers created by get_logger_st from now on.
+void CORE_EXPORT        set_logger_st_flush_policy(const ray::RayLogFlushPolicy& flush_policy);
+/// Set the rate limit of loggers created by get_logger_st from now on; global_rate is ignored.
+void CORE_EXPORT        set_logger_st_rate_limit(const ray::RayLogRateLimit& rate_limit);
 void CORE_EXPORT        write_header(std::shared_ptr<spdlog::logger> logger, const std::string& header_msg);
 void CORE_EXPORT        write_log(std::shared_ptr<spdlog::logger> logger, const std::string& log_msg);
 std::string CORE_EXPORT get_current_time_str();
\ No newline at end of file
@@ -0,0 +1,129 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef background_rotating_file_sink_inl_h
+#define background_rotating_file_sink_inl_h
+
+#include "common.h"
+#ifndef VTPL_HEADER_ONLY
+#include "background_rotating_file_sink.h"
+#endif
+
+#include <spdlog/common.h>
+#include <spdlog/details/os.h>
+
+#include <cerrno>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace vtpl
+{
+namespace sinks
+{
+template <typename Mutex>
+VTPL_INLINE background_rotating_file_sink<Mutex>::background_rotating_file_sink(
+    spdlog::filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open,
+    const spdlog::file_event_handlers& event_handlers, vtpl::rotation_compression compression)
+    : base_filename_(std::move(base_filename)), max_size_(max_size), max_files_(max_files), compression_(compression),
+      file_helper_{event_handlers}
+{
+  if (max_size == 0) {
+    spdlog::throw_spdlog_ex("rotating sink constructor: max_size arg cannot be zero");
+  }
+
+  if (max_files > 200000) {
+    spdlog::throw_spdlog_ex("rotating sink constructor: max_files arg cannot exceed 200000");
+  }
+  vtpl::details::rotation_worker::instance().recover_pending_files(base_filename_, max_files_, compression_);
+  file_helper_.open(base_filename_);
+  current_size_ = file_helper_.size(); // expensive. called only once
+  if (rotate_on_open && current_size_ > 0) {
+    if (!rotate_()) {
+      spdlog::throw_spdlog_ex("background_rotating_file_sink: failed renaming " +
+                                  spdlog::details::os::filename_to_str(base_filename_),
+                              errno);
+    }
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE spdlog::filename_t background_rotating_file_sink<Mutex>::filename()
+{
+  std::lock_guard<Mutex> lock(spdlog::sinks::base_sink<Mutex>::mutex_);
+  return file_helper_.filename();
+}
+
+template <typename Mutex>
+VTPL_INLINE void background_rotating_file_sink<Mutex>::sink_it_(const spdlog::details::log_msg& msg)
+{
+  spdlog::memory_buf_t formatted;
+  spdlog::sinks::base_sink<Mutex>::formatter_->format(msg, formatted);
+  auto new_size = current_size_ + formatted.size();
+
+  // rotate if the new estimated file size exceeds max size.
+  // rotate only if the real size > 0 to better deal with full disk (see issue #2261).
+  // we only check the real size when new_size > max_size_ because it is relatively expensive.
+  bool rotated = true;
+  if (new_size > max_size_) {
+    file_helper_.flush();
+    if (file_helper_.size() > 0) {
+      rotated = rotate_();
+      new_size = formatted.size();
+    }
+  }
+  file_helper_.write(formatted);
+  current_size_ = new_size;
+  if (!rotated) {
+    spdlog::throw_spdlog_ex("background_rotating_file_sink: failed renaming " +
+                                spdlog::details::os::filename_to_str(base_filename_),
+                            errno);
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE void background_rotating_file_sink<Mutex>::flush_()
+{
+  file_helper_.flush();
+}
+
+template <typename Mutex>
+VTPL_INLINE bool background_rotating_file_sink<Mutex>::rotate_()
+{
+  using vtpl::details::rotation_worker;
+  namespace os = spdlog::details::os;
+
+  file_helper_.close();
+  const spdlog::filename_t pending = rotation_worker::new_pending_filename(base_filename_);
+  if (os::rename(base_filename_, pending) != 0) {
+    // Keep writing to the full file rather than truncating it.
+    file_helper_.reopen(false);
+    return false;
+  }
+  const spdlog::filename_t next = rotation_worker::next_filename(base_filename_);
+  if (os::path_exists(next)) {
+    (void)os::rename(next, base_filename_);
+  }
+  file_helper_.open(base_filename_);
+
+  const spdlog::filename_t base_filename = base_filename_;
+  const std::size_t max_files = max_files_;
+  const vtpl::rotation_compression compression = compression_;
+  rotation_worker::instance().post([base_filename, pending, next, max_files, compression] {
+    rotation_worker::shift_files(base_filename, pending, max_files, compression);
+    // Create the next file under another name, so it only appears once complete.
+    const spdlog::filename_t preparing = rotation_worker::pending_filename(next, 0);
+    spdlog::details::file_helper prepared;
+    prepared.open(preparing, true);
+    prepared.close();
+    (void)os::remove_if_exists(next);
+    (void)os::rename(preparing, next);
+  });
+  return true;
+}
+
+} // namespace sinks
+} // namespace vtpl
+#endif // background_rotating_file_sink_inl_h
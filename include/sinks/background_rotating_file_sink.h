@@ -0,0 +1,91 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+#pragma once
+#ifndef background_rotating_file_sink_h
+#define background_rotating_file_sink_h
+#include "common.h"
+#include "details/rotation_worker.h"
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/details/synchronous_factory.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <mutex>
+#include <string>
+
+namespace vtpl
+{
+namespace sinks
+{
+// Size based rotating file sink, like spdlog::sinks::rotating_file_sink, that
+// keeps rotation off the logging threads. Under the sink lock a full file is
+// only renamed to a pending name and the active file swapped for an empty one
+// prepared in advance; the rename cascade, deletion of the oldest file and any
+// retry run on the rotation_worker thread.
+// Until the worker catches up, the full file is named log.rotating<pid>-N.txt
+// and log.1.txt still holds the file before it. Pending files left by a process
+// that died meanwhile are shifted into the rotation when a sink of the same
+// file is created.
+// If the full file cannot be renamed it keeps growing until max_size more
+// bytes were written, then rotation is tried again.
+// With compression, rotated files are compressed by the worker as well
+// (log.1.txt.gz, log.2.txt.gz, ...).
+template <typename Mutex>
+class background_rotating_file_sink final : public spdlog::sinks::base_sink<Mutex>
+{
+public:
+  background_rotating_file_sink(spdlog::filename_t base_filename, std::size_t max_size, std::size_t max_files,
+                                bool rotate_on_open = false, const spdlog::file_event_handlers& event_handlers = {},
+                                vtpl::rotation_compression compression = vtpl::rotation_compression::none);
+  spdlog::filename_t filename();
+
+protected:
+  void sink_it_(const spdlog::details::log_msg& msg) override;
+  void flush_() override;
+
+private:
+  // Swap the active file for the prepared one and hand the full file to the
+  // rotation worker. Returns false if the full file could not be renamed.
+  bool rotate_();
+
+  spdlog::filename_t base_filename_;
+  std::size_t max_size_;
+  std::size_t max_files_;
+  std::size_t current_size_;
+  vtpl::rotation_compression compression_;
+  spdlog::details::file_helper file_helper_;
+};
+
+using background_rotating_file_sink_mt = background_rotating_file_sink<std::mutex>;
+using background_rotating_file_sink_st = background_rotating_file_sink<spdlog::details::null_mutex>;
+} // namespace sinks
+//
+// factory functions
+//
+template <typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<spdlog::logger>
+background_rotating_logger_mt(const std::string& logger_name, const spdlog::filename_t& filename,
+                              size_t max_file_size, size_t max_files, bool rotate_on_open = false,
+                              const spdlog::file_event_handlers& event_handlers = {},
+                              vtpl::rotation_compression compression = vtpl::rotation_compression::none)
+{
+  return Factory::template create<vtpl::sinks::background_rotating_file_sink_mt>(
+      logger_name, filename, max_file_size, max_files, rotate_on_open, event_handlers, compression);
+}
+template <typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<spdlog::logger>
+background_rotating_logger_st(const std::string& logger_name, const spdlog::filename_t& filename,
+                              size_t max_file_size, size_t max_files, bool rotate_on_open = false,
+                              const spdlog::file_event_handlers& event_handlers = {},
+                              vtpl::rotation_compression compression = vtpl::rotation_compression::none)
+{
+  return Factory::template create<vtpl::sinks::background_rotating_file_sink_st>(
+      logger_name, filename, max_file_size, max_files, rotate_on_open, event_handlers, compression);
+}
+} // namespace vtpl
+#ifdef VTPL_HEADER_ONLY
+#include "background_rotating_file_sink-inl.h"
+#endif
+
+#endif // background_rotating_file_sink_h
@@ -0,0 +1,211 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef binary_file_sink_inl_h
+#define binary_file_sink_inl_h
+
+#include "common.h"
+#ifndef VTPL_HEADER_ONLY
+#include "binary_file_sink.h"
+#endif
+
+#include "details/binary_log_format.h"
+#include <spdlog/common.h>
+#include <spdlog/details/os.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace vtpl
+{
+namespace sinks
+{
+namespace binary_log = vtpl::details::binary_log;
+
+template <typename Mutex>
+VTPL_INLINE binary_file_sink<Mutex>::binary_file_sink(spdlog::filename_t base_filename, std::size_t max_size,
+                                                       std::size_t max_files, vtpl::rotation_compression compression)
+    : base_filename_(std::move(base_filename)), max_size_(max_size), max_files_(max_files), compression_(compression)
+{
+  if (max_size == 0) {
+    spdlog::throw_spdlog_ex("binary_file_sink constructor: max_size arg cannot be zero");
+  }
+  if (max_files > 200000) {
+    spdlog::throw_spdlog_ex("binary_file_sink constructor: max_files arg cannot exceed 200000");
+  }
+  vtpl::details::rotation_worker::instance().recover_pending_files(base_filename_, max_files_, compression_);
+  file_helper_.open(base_filename_);
+  // If it cannot be moved away, the old file is truncated: appending to it
+  // would produce an undecodable file.
+  if (file_helper_.size() == 0 || !rotate_()) {
+    start_file_();
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE spdlog::filename_t binary_file_sink<Mutex>::filename()
+{
+  std::lock_guard<Mutex> lock(spdlog::sinks::base_sink<Mutex>::mutex_);
+  return file_helper_.filename();
+}
+
+template <typename Mutex>
+VTPL_INLINE void binary_file_sink<Mutex>::sink_it_(const spdlog::details::log_msg& msg)
+{
+  encode_(msg);
+  // rotate only if the real size > 0 to better deal with full disk (see spdlog issue #2261).
+  if (current_size_ + entries_.size() > max_size_ && current_size_ > binary_log::header_size && rotate_()) {
+    // The entries refer to ids of the full file: encode the record again for the new one.
+    entries_.clear();
+    encode_(msg);
+  }
+  file_helper_.write(entries_);
+  current_size_ += entries_.size();
+  entries_.clear();
+}
+
+template <typename Mutex>
+VTPL_INLINE void binary_file_sink<Mutex>::encode_(const spdlog::details::log_msg& msg)
+{
+  const uint64_t logger_id = logger_id_(msg.logger_name);
+  const uint64_t source_id = msg.source.empty() ? 0 : source_id_(msg.source);
+
+  const int64_t time_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count();
+  char fields[1 + 6 * binary_log::max_varint_size];
+  char* out = fields;
+  *out++ = static_cast<char>(binary_log::entry_type::record);
+  out = binary_log::put_varint(out, binary_log::zigzag_encode(time_ns - last_time_ns_));
+  *out++ = static_cast<char>(msg.level);
+  out = binary_log::put_varint(out, msg.thread_id);
+  out = binary_log::put_varint(out, logger_id);
+  out = binary_log::put_varint(out, source_id);
+  out = binary_log::put_varint(out, msg.payload.size());
+  body_.append(fields, out);
+  body_.append(msg.payload.data(), msg.payload.data() + msg.payload.size());
+  add_entry_();
+  last_time_ns_ = time_ns;
+}
+
+template <typename Mutex>
+VTPL_INLINE void binary_file_sink<Mutex>::flush_()
+{
+  file_helper_.flush();
+}
+
+template <typename Mutex>
+VTPL_INLINE void binary_file_sink<Mutex>::start_file_()
+{
+  file_helper_.open(base_filename_, true);
+  logger_ids_.clear();
+  source_ids_.clear();
+  next_id_ = 1;
+  last_time_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      spdlog::log_clock::now().time_since_epoch())
+                      .count();
+
+  char header[binary_log::header_size];
+  char* out = header;
+  std::memcpy(out, binary_log::magic, sizeof(binary_log::magic));
+  out += sizeof(binary_log::magic);
+  *out++ = static_cast<char>(binary_log::version);
+  out = binary_log::put_fixed(out, static_cast<uint64_t>(last_time_ns_), 8);
+  out = binary_log::put_fixed(out, static_cast<uint64_t>(spdlog::details::os::pid()), 4);
+  spdlog::memory_buf_t buffer;
+  buffer.append(header, out);
+  file_helper_.write(buffer);
+  current_size_ = buffer.size();
+}
+
+template <typename Mutex>
+VTPL_INLINE bool binary_file_sink<Mutex>::rotate_()
+{
+  using vtpl::details::rotation_worker;
+  namespace os = spdlog::details::os;
+
+  file_helper_.close();
+  const spdlog::filename_t pending = rotation_worker::new_pending_filename(base_filename_);
+  if (os::rename(base_filename_, pending) != 0) {
+    file_helper_.reopen(false);
+    return false;
+  }
+  start_file_();
+
+  const spdlog::filename_t base_filename = base_filename_;
+  const std::size_t max_files = max_files_;
+  const vtpl::rotation_compression compression = compression_;
+  rotation_worker::instance().post([base_filename, pending, max_files, compression] {
+    rotation_worker::shift_files(base_filename, pending, max_files, compression);
+  });
+  return true;
+}
+
+template <typename Mutex>
+VTPL_INLINE uint64_t binary_file_sink<Mutex>::logger_id_(spdlog::string_view_t name)
+{
+  std::string key(name.data(), name.size());
+  auto it = logger_ids_.find(key);
+  if (it != logger_ids_.end()) {
+    return it->second;
+  }
+  const uint64_t id = next_id_++;
+  char fields[1 + 2 * binary_log::max_varint_size];
+  char* out = fields;
+  *out++ = static_cast<char>(binary_log::entry_type::logger_name);
+  out = binary_log::put_varint(out, id);
+  out = binary_log::put_varint(out, name.size());
+  body_.append(fields, out);
+  body_.append(name.data(), name.data() + name.size());
+  add_entry_();
+  logger_ids_.emplace(std::move(key), id);
+  return id;
+}
+
+template <typename Mutex>
+VTPL_INLINE uint64_t binary_file_sink<Mutex>::source_id_(const spdlog::source_loc& source)
+{
+  const auto key = std::make_tuple(source.filename, source.line, source.funcname);
+  auto it = source_ids_.find(key);
+  if (it != source_ids_.end()) {
+    return it->second;
+  }
+  const uint64_t id = next_id_++;
+  const std::size_t file_size = std::strlen(source.filename);
+  const std::size_t function_size = source.funcname != nullptr ? std::strlen(source.funcname) : 0;
+  char fields[1 + 3 * binary_log::max_varint_size];
+  char* out = fields;
+  *out++ = static_cast<char>(binary_log::entry_type::source_location);
+  out = binary_log::put_varint(out, id);
+  out = binary_log::put_varint(out, static_cast<uint64_t>(source.line));
+  out = binary_log::put_varint(out, file_size);
+  body_.append(fields, out);
+  body_.append(source.filename, source.filename + file_size);
+  out = binary_log::put_varint(fields, function_size);
+  body_.append(fields, out);
+  if (function_size > 0) {
+    body_.append(source.funcname, source.funcname + function_size);
+  }
+  add_entry_();
+  source_ids_.emplace(key, id);
+  return id;
+}
+
+template <typename Mutex>
+VTPL_INLINE void binary_file_sink<Mutex>::add_entry_()
+{
+  char length[binary_log::max_varint_size];
+  char* end = binary_log::put_varint(length, body_.size());
+  entries_.append(length, end);
+  entries_.append(body_.data(), body_.data() + body_.size());
+  body_.clear();
+}
+
+} // namespace sinks
+} // namespace vtpl
+#endif // binary_file_sink_inl_h
@@ -0,0 +1,100 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+#pragma once
+#ifndef binary_file_sink_h
+#define binary_file_sink_h
+#include "common.h"
+#include "details/rotation_worker.h"
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/details/synchronous_factory.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+namespace vtpl
+{
+namespace sinks
+{
+// Size based rotating file sink writing records unformatted, in the compact
+// binary format of details/binary_log_format.h: no date or pattern is rendered
+// on the logging thread, logger names and source locations are written once per
+// file and then referred to by id. binary_log_decoder turns the files back into
+// text with the usual pattern.
+// Files are rotated like in background_rotating_file_sink, with the rename
+// cascade on the rotation_worker thread. A file found non-empty on start is
+// rotated away, since appending would need its id tables.
+template <typename Mutex>
+class binary_file_sink final : public spdlog::sinks::base_sink<Mutex>
+{
+public:
+  binary_file_sink(spdlog::filename_t base_filename, std::size_t max_size, std::size_t max_files,
+                   vtpl::rotation_compression compression = vtpl::rotation_compression::none);
+  spdlog::filename_t filename();
+
+protected:
+  void sink_it_(const spdlog::details::log_msg& msg) override;
+  void flush_() override;
+
+private:
+  // Truncate or create the active file and write its header.
+  void start_file_();
+  // Move the full file out of the way and start a new one. Returns false if the
+  // full file could not be renamed; it is then kept.
+  bool rotate_();
+  // Append the entries of a record, and of ids it is the first to use, to entries_.
+  void encode_(const spdlog::details::log_msg& msg);
+  uint64_t logger_id_(spdlog::string_view_t name);
+  uint64_t source_id_(const spdlog::source_loc& source);
+  // Append the entry in body_ to entries_.
+  void add_entry_();
+
+  spdlog::filename_t base_filename_;
+  std::size_t max_size_;
+  std::size_t max_files_;
+  vtpl::rotation_compression compression_;
+  std::size_t current_size_{0};
+  int64_t last_time_ns_{0};
+  uint64_t next_id_{1};
+  std::unordered_map<std::string, uint64_t> logger_ids_;
+  // Keyed by address: source locations point to string literals.
+  std::map<std::tuple<const char*, int, const char*>, uint64_t> source_ids_;
+  spdlog::memory_buf_t body_;
+  spdlog::memory_buf_t entries_;
+  spdlog::details::file_helper file_helper_;
+};
+
+using binary_file_sink_mt = binary_file_sink<std::mutex>;
+using binary_file_sink_st = binary_file_sink<spdlog::details::null_mutex>;
+} // namespace sinks
+//
+// factory functions
+//
+template <typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<spdlog::logger>
+binary_logger_mt(const std::string& logger_name, const spdlog::filename_t& filename, size_t max_file_size,
+                 size_t max_files, vtpl::rotation_compression compression = vtpl::rotation_compression::none)
+{
+  return Factory::template create<vtpl::sinks::binary_file_sink_mt>(logger_name, filename, max_file_size, max_files,
+                                                                    compression);
+}
+template <typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<spdlog::logger>
+binary_logger_st(const std::string& logger_name, const spdlog::filename_t& filename, size_t max_file_size,
+                 size_t max_files, vtpl::rotation_compression compression = vtpl::rotation_compression::none)
+{
+  return Factory::template create<vtpl::sinks::binary_file_sink_st>(logger_name, filename, max_file_size, max_files,
+                                                                    compression);
+}
+} // namespace vtpl
+#ifdef VTPL_HEADER_ONLY
+#include "binary_file_sink-inl.h"
+#endif
+
+#endif // binary_file_sink_h
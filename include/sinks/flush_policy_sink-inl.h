@@ -0,0 +1,95 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef flush_policy_sink_inl_h
+#define flush_policy_sink_inl_h
+
+#include "common.h"
+#ifndef VTPL_HEADER_ONLY
+#include "flush_policy_sink.h"
+#endif
+
+#include <spdlog/common.h>
+
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace vtpl
+{
+namespace sinks
+{
+template <typename Mutex>
+VTPL_INLINE flush_policy_sink<Mutex>::flush_policy_sink(spdlog::sink_ptr inner, spdlog::level::level_enum flush_level,
+                                                        std::size_t flush_bytes,
+                                                        std::chrono::milliseconds flush_interval)
+    : inner_(std::move(inner)), flush_level_(flush_level), flush_bytes_(flush_bytes), flush_interval_(flush_interval),
+      last_flush_(std::chrono::steady_clock::now())
+{
+  if (!inner_) {
+    spdlog::throw_spdlog_ex("flush_policy_sink constructor: inner sink cannot be null");
+  }
+  if (background_flush_ && flush_interval_.count() > 0) {
+    vtpl::details::periodic_flusher::instance().add(this, flush_interval_);
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE flush_policy_sink<Mutex>::~flush_policy_sink()
+{
+  if (background_flush_ && flush_interval_.count() > 0) {
+    vtpl::details::periodic_flusher::instance().remove(this);
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE void flush_policy_sink<Mutex>::sink_it_(const spdlog::details::log_msg& msg)
+{
+  if (!inner_->should_log(msg.level)) {
+    return;
+  }
+  inner_->log(msg);
+  unflushed_bytes_ += msg.payload.size();
+
+  if (msg.level >= flush_level_ || (flush_bytes_ > 0 && unflushed_bytes_ >= flush_bytes_)) {
+    flush_();
+  } else if (!background_flush_ && flush_interval_.count() > 0 &&
+             std::chrono::steady_clock::now() - last_flush_ >= flush_interval_) {
+    flush_();
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE void flush_policy_sink<Mutex>::flush_()
+{
+  inner_->flush();
+  unflushed_bytes_ = 0;
+  last_flush_ = std::chrono::steady_clock::now();
+}
+
+template <typename Mutex>
+VTPL_INLINE void flush_policy_sink<Mutex>::set_pattern_(const std::string& pattern)
+{
+  inner_->set_pattern(pattern);
+}
+
+template <typename Mutex>
+VTPL_INLINE void flush_policy_sink<Mutex>::set_formatter_(std::unique_ptr<spdlog::formatter> sink_formatter)
+{
+  inner_->set_formatter(std::move(sink_formatter));
+}
+
+template <typename Mutex>
+VTPL_INLINE void flush_policy_sink<Mutex>::flush_if_due(std::chrono::steady_clock::time_point now)
+{
+  std::lock_guard<Mutex> lock(spdlog::sinks::base_sink<Mutex>::mutex_);
+  if (unflushed_bytes_ > 0 && now - last_flush_ >= flush_interval_) {
+    flush_();
+  }
+}
+
+} // namespace sinks
+} // namespace vtpl
+#endif // flush_policy_sink_inl_h
@@ -0,0 +1,66 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+#pragma once
+#ifndef flush_policy_sink_h
+#define flush_policy_sink_h
+#include "common.h"
+#include "details/periodic_flusher.h"
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace vtpl
+{
+namespace sinks
+{
+// Forwards records to another sink and decides when that sink is flushed:
+// after any record at or above flush_level, once flush_bytes of payload were
+// written since the last flush, or flush_interval after the last flush.
+// With a real mutex the interval is enforced by the periodic flusher thread, so
+// an idle sink is flushed too; with null_mutex it is checked on the next record.
+// A zero flush_bytes or flush_interval disables that trigger.
+template <typename Mutex>
+class flush_policy_sink : public spdlog::sinks::base_sink<Mutex>, private vtpl::details::flush_target
+{
+public:
+  flush_policy_sink(spdlog::sink_ptr inner, spdlog::level::level_enum flush_level, std::size_t flush_bytes,
+                    std::chrono::milliseconds flush_interval);
+  ~flush_policy_sink() override;
+
+  flush_policy_sink(const flush_policy_sink&) = delete;
+  flush_policy_sink& operator=(const flush_policy_sink&) = delete;
+
+  const spdlog::sink_ptr& inner() const { return inner_; }
+
+protected:
+  void sink_it_(const spdlog::details::log_msg& msg) override;
+  void flush_() override;
+  void set_pattern_(const std::string& pattern) override;
+  void set_formatter_(std::unique_ptr<spdlog::formatter> sink_formatter) override;
+
+private:
+  static constexpr bool background_flush_ = !std::is_same<Mutex, spdlog::details::null_mutex>::value;
+
+  void flush_if_due(std::chrono::steady_clock::time_point now) override;
+
+  spdlog::sink_ptr inner_;
+  spdlog::level::level_enum flush_level_;
+  std::size_t flush_bytes_;
+  std::chrono::milliseconds flush_interval_;
+  std::size_t unflushed_bytes_{0};
+  std::chrono::steady_clock::time_point last_flush_;
+};
+
+using flush_policy_sink_mt = flush_policy_sink<std::mutex>;
+using flush_policy_sink_st = flush_policy_sink<spdlog::details::null_mutex>;
+} // namespace sinks
+} // namespace vtpl
+#ifdef VTPL_HEADER_ONLY
+#include "flush_policy_sink-inl.h"
+#endif
+
+#endif // flush_policy_sink_h
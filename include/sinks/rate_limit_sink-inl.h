@@ -0,0 +1,186 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#pragma once
+#ifndef rate_limit_sink_inl_h
+#define rate_limit_sink_inl_h
+
+#include "common.h"
+#ifndef VTPL_HEADER_ONLY
+#include "rate_limit_sink.h"
+#endif
+
+#include <spdlog/common.h>
+#include <spdlog/fmt/fmt.h>
+
+#include <functional>
+#include <string_view>
+#include <utility>
+
+namespace vtpl
+{
+namespace sinks
+{
+template <typename Mutex>
+VTPL_INLINE rate_limit_sink<Mutex>::rate_limit_sink(spdlog::sink_ptr inner, double rate, std::size_t burst,
+                                                    std::chrono::milliseconds duplicate_window,
+                                                    std::shared_ptr<vtpl::details::token_bucket> shared_bucket,
+                                                    std::shared_ptr<rate_limit_counters> counters)
+    : inner_(std::move(inner)), bucket_(rate, static_cast<double>(burst)), shared_bucket_(std::move(shared_bucket)),
+      duplicate_window_(duplicate_window), counters_(std::move(counters)), last_expire_(std::chrono::steady_clock::now())
+{
+  if (!inner_) {
+    spdlog::throw_spdlog_ex("rate_limit_sink constructor: inner sink cannot be null");
+  }
+  if (background_sweep_ && duplicate_window_.count() > 0) {
+    vtpl::details::periodic_flusher::instance().add(this, duplicate_window_);
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE rate_limit_sink<Mutex>::~rate_limit_sink()
+{
+  if (background_sweep_ && duplicate_window_.count() > 0) {
+    vtpl::details::periodic_flusher::instance().remove(this);
+  }
+  std::lock_guard<Mutex> lock(spdlog::sinks::base_sink<Mutex>::mutex_);
+  expire_(std::chrono::steady_clock::time_point::max());
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::sink_it_(const spdlog::details::log_msg& msg)
+{
+  if (!inner_->should_log(msg.level)) {
+    return;
+  }
+  if (msg.level < spdlog::level::critical) {
+    const auto now = std::chrono::steady_clock::now();
+    if (duplicate_window_.count() > 0 && is_duplicate_(msg, now)) {
+      count_(&rate_limit_counters::duplicates);
+      return;
+    }
+    if (!bucket_.try_take(now) || (shared_bucket_ != nullptr && !shared_bucket_->try_take(now))) {
+      ++dropped_since_written_;
+      count_(&rate_limit_counters::dropped);
+      return;
+    }
+  }
+  if (dropped_since_written_ > 0) {
+    report_dropped_(msg);
+  }
+  inner_->log(msg);
+}
+
+template <typename Mutex>
+VTPL_INLINE bool rate_limit_sink<Mutex>::is_duplicate_(const spdlog::details::log_msg& msg,
+                                                       std::chrono::steady_clock::time_point now)
+{
+  if (!background_sweep_ && now - last_expire_ >= duplicate_window_) {
+    expire_(now);
+  }
+  const std::string_view payload(msg.payload.data(), msg.payload.size());
+  const uint64_t key = std::hash<std::string_view>()(payload) ^
+                       (std::hash<const void*>()(msg.source.filename) * 31 + static_cast<uint64_t>(msg.source.line));
+
+  auto it = recent_.find(key);
+  if (it != recent_.end() && it->second.payload == payload) {
+    if (now - it->second.first_seen < duplicate_window_) {
+      ++it->second.repeats;
+      return true;
+    }
+    report_repeats_(it->second);
+    it->second.first_seen = now;
+    return false;
+  }
+  if (it != recent_.end()) {
+    // Another record with the same hash: it loses its slot.
+    report_repeats_(it->second);
+    recent_.erase(it);
+  }
+  if (recent_.size() >= max_recent_records_) {
+    expire_(std::chrono::steady_clock::time_point::max());
+  }
+  recent_record record;
+  record.payload.assign(payload.data(), payload.size());
+  record.logger_name.assign(msg.logger_name.data(), msg.logger_name.size());
+  record.level = msg.level;
+  record.first_seen = now;
+  recent_.emplace(key, std::move(record));
+  return false;
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::report_repeats_(recent_record& record)
+{
+  if (record.repeats == 0) {
+    return;
+  }
+  const std::string text = fmt::format("last message repeated {} times: {}", record.repeats, record.payload);
+  inner_->log(spdlog::details::log_msg(spdlog::source_loc{}, record.logger_name, record.level, text));
+  record.repeats = 0;
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::expire_(std::chrono::steady_clock::time_point now)
+{
+  for (auto it = recent_.begin(); it != recent_.end();) {
+    if (now == std::chrono::steady_clock::time_point::max() || now - it->second.first_seen >= duplicate_window_) {
+      report_repeats_(it->second);
+      it = recent_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (now != std::chrono::steady_clock::time_point::max()) {
+    last_expire_ = now;
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::report_dropped_(const spdlog::details::log_msg& msg)
+{
+  const std::string text = fmt::format("{} records dropped by the rate limit", dropped_since_written_);
+  inner_->log(spdlog::details::log_msg(spdlog::source_loc{}, msg.logger_name, spdlog::level::warn, text));
+  dropped_since_written_ = 0;
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::count_(std::atomic<uint64_t> rate_limit_counters::*counter)
+{
+  (own_counters_.*counter).fetch_add(1, std::memory_order_relaxed);
+  if (counters_ != nullptr) {
+    ((*counters_).*counter).fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::flush_()
+{
+  inner_->flush();
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::set_pattern_(const std::string& pattern)
+{
+  inner_->set_pattern(pattern);
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::set_formatter_(std::unique_ptr<spdlog::formatter> sink_formatter)
+{
+  inner_->set_formatter(std::move(sink_formatter));
+}
+
+template <typename Mutex>
+VTPL_INLINE void rate_limit_sink<Mutex>::flush_if_due(std::chrono::steady_clock::time_point now)
+{
+  std::lock_guard<Mutex> lock(spdlog::sinks::base_sink<Mutex>::mutex_);
+  if (!recent_.empty()) {
+    expire_(now);
+  }
+}
+
+} // namespace sinks
+} // namespace vtpl
+#endif // rate_limit_sink_inl_h
@@ -0,0 +1,107 @@
+// *****************************************************
+//    Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+#pragma once
+#ifndef rate_limit_sink_h
+#define rate_limit_sink_h
+#include "common.h"
+#include "details/periodic_flusher.h"
+#include "details/token_bucket.h"
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace vtpl
+{
+namespace sinks
+{
+// Records held back by rate_limit_sinks, possibly shared by several of them.
+struct rate_limit_counters {
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> duplicates{0};
+};
+
+// Forwards records to another sink, protecting it from log storms.
+// Records are dropped while the token bucket of the sink, or the one it shares
+// with other sinks, is empty; the next record written is preceded by
+// "N records dropped by the rate limit".
+// With a duplicate_window, a record with the same payload and source location
+// as one seen less than duplicate_window ago is only counted, and
+// "last message repeated N times: <payload>" is written once the window is over.
+// With a real mutex that happens on the periodic flusher thread, so it is not
+// delayed until the next record; with null_mutex it is checked on the next record.
+// Critical records are never held back. A zero rate or duplicate_window disables that part.
+template <typename Mutex>
+class rate_limit_sink final : public spdlog::sinks::base_sink<Mutex>, private vtpl::details::flush_target
+{
+public:
+  rate_limit_sink(spdlog::sink_ptr inner, double rate, std::size_t burst, std::chrono::milliseconds duplicate_window,
+                  std::shared_ptr<vtpl::details::token_bucket> shared_bucket = nullptr,
+                  std::shared_ptr<rate_limit_counters> counters = nullptr);
+  ~rate_limit_sink() override;
+
+  rate_limit_sink(const rate_limit_sink&) = delete;
+  rate_limit_sink& operator=(const rate_limit_sink&) = delete;
+
+  const spdlog::sink_ptr& inner() const { return inner_; }
+  // Records of this sink dropped by a token bucket.
+  uint64_t dropped_count() const { return own_counters_.dropped.load(std::memory_order_relaxed); }
+  // Records of this sink counted as repetitions instead of being written.
+  uint64_t duplicate_count() const { return own_counters_.duplicates.load(std::memory_order_relaxed); }
+
+protected:
+  void sink_it_(const spdlog::details::log_msg& msg) override;
+  void flush_() override;
+  void set_pattern_(const std::string& pattern) override;
+  void set_formatter_(std::unique_ptr<spdlog::formatter> sink_formatter) override;
+
+private:
+  static constexpr bool background_sweep_ = !std::is_same<Mutex, spdlog::details::null_mutex>::value;
+  // Distinct records remembered at once; when full, all are reported and forgotten.
+  static constexpr std::size_t max_recent_records_ = 1024;
+
+  struct recent_record {
+    std::string payload;
+    std::string logger_name;
+    spdlog::level::level_enum level;
+    std::chrono::steady_clock::time_point first_seen;
+    std::size_t repeats{0};
+  };
+
+  void flush_if_due(std::chrono::steady_clock::time_point now) override;
+
+  // Returns true if msg repeats a record of the current window.
+  bool is_duplicate_(const spdlog::details::log_msg& msg, std::chrono::steady_clock::time_point now);
+  void report_repeats_(recent_record& record);
+  // Report and forget the records whose window ended before `now`.
+  void expire_(std::chrono::steady_clock::time_point now);
+  void report_dropped_(const spdlog::details::log_msg& msg);
+  void count_(std::atomic<uint64_t> rate_limit_counters::*counter);
+
+  spdlog::sink_ptr inner_;
+  vtpl::details::token_bucket bucket_;
+  std::shared_ptr<vtpl::details::token_bucket> shared_bucket_;
+  std::chrono::milliseconds duplicate_window_;
+  rate_limit_counters own_counters_;
+  std::shared_ptr<rate_limit_counters> counters_;
+  std::unordered_map<uint64_t, recent_record> recent_;
+  std::chrono::steady_clock::time_point last_expire_;
+  std::size_t dropped_since_written_{0};
+};
+
+using rate_limit_sink_mt = rate_limit_sink<std::mutex>;
+using rate_limit_sink_st = rate_limit_sink<spdlog::details::null_mutex>;
+} // namespace sinks
+} // namespace vtpl
+#ifdef VTPL_HEADER_ONLY
+#include "rate_limit_sink-inl.h"
+#endif
+
+#endif // rate_limit_sink_h
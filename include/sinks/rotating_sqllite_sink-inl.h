@@ -21,7 +21,9 @@
 
 #include <cerrno>
 #include <chrono>
+#include <cstdio>
 #include <ctime>
+#include <exception>
 #include <mutex>
 #include <string>
 #include <tuple>
@@ -33,9 +35,10 @@ template <typename Mutex>
 VTPL_INLINE rotating_sqllite_sink<Mutex>::rotating_sqllite_sink(spdlog::filename_t base_filename,
                                                                   std::size_t max_size, std::size_t max_files,
                                                                   bool rotate_on_open,
-                                                                  const vtpl::sqllite_event_handlers& event_handlers)
-    : base_filename_(std::move(base_filename)), max_size_(max_size), max_files_(max_files),
-      file_sqllite_helper_{event_handlers}
+                                                                  const vtpl::sqllite_event_handlers& event_handlers,
+                                                                  const vtpl::sqllite_options& options)
+    : base_filename_(std::move(base_filename)), max_size_(max_size), max_files_(max_files), rotate_at_(max_size),
+      file_sqllite_helper_{event_handlers, options}
 {
   if (max_size == 0) {
     spdlog::throw_spdlog_ex("rotating sink constructor: max_size arg cannot be zero");
@@ -44,11 +47,23 @@ VTPL_INLINE rotating_sqllite_sink<Mutex>::rotating_sqllite_sink(spdlog::filename
   if (max_files > 200000) {
     spdlog::throw_spdlog_ex("rotating sink constructor: max_files arg cannot exceed 200000");
   }
+  if (!options.background_rotation && options.compression == vtpl::rotation_compression::none) {
+    recover_pending_files_(base_filename_, max_files_, options);
+  } else {
+    const spdlog::filename_t base = base_filename_;
+    const std::size_t max_files = max_files_;
+    vtpl::details::rotation_worker::instance().post(
+        [base, max_files, options] { recover_pending_files_(base, max_files, options); });
+  }
   file_sqllite_helper_.open(calc_filename(base_filename_, 0));
-  current_size_ = file_sqllite_helper_.size(); // expensive. called only once
-  if (rotate_on_open && current_size_ > 0) {
-    rotate_();
-    current_size_ = 0;
+  if (rotate_on_open && !file_sqllite_helper_.empty()) {
+    if (!options.background_rotation && options.compression == vtpl::rotation_compression::none) {
+      rotate_();
+    } else if (!rotate_in_background_()) {
+      spdlog::throw_spdlog_ex("rotating_sqllite_sink: failed renaming " +
+                                  spdlog::details::os::filename_to_str(base_filename_),
+                              errno);
+    }
   }
 }
 
@@ -77,22 +92,39 @@ VTPL_INLINE spdlog::filename_t rotating_sqllite_sink<Mutex>::filename()
 template <typename Mutex>
 VTPL_INLINE void rotating_sqllite_sink<Mutex>::sink_it_(const spdlog::details::log_msg& msg)
 {
-  spdlog::memory_buf_t formatted;
-  spdlog::sinks::base_sink<Mutex>::formatter_->format(msg, formatted);
-  auto new_size = current_size_ + formatted.size();
-
-  // rotate if the new estimated file size exceeds max size.
-  // rotate only if the real size > 0 to better deal with full disk (see issue #2261).
-  // we only check the real size when new_size > max_size_ because it is relatively expensive.
-  if (new_size > max_size_) {
-    file_sqllite_helper_.flush();
-    if (file_sqllite_helper_.size() > 0) {
+  // The fields of msg are stored in columns of their own, the formatter is not used.
+  // size() costs no query: it is the size measured at the last batch commit plus
+  // an estimate of the rows written since. Only when that reaches max_size_ is
+  // the real size measured, so the file is rotated once it really is full.
+  // rotate only if the file holds rows to better deal with full disk (see issue #2261).
+  bool rotated = true;
+  if (file_sqllite_helper_.size() >= rotate_at_ && file_sqllite_helper_.exact_size() >= rotate_at_ &&
+      !file_sqllite_helper_.empty()) {
+    const vtpl::sqllite_options& options = file_sqllite_helper_.options();
+    if (options.background_rotation || options.compression != vtpl::rotation_compression::none) {
+      rotated = rotate_in_background_();
+    } else {
       rotate_();
-      new_size = formatted.size();
     }
   }
-  file_sqllite_helper_.write(formatted);
-  current_size_ = new_size;
+  file_sqllite_helper_.write(msg);
+  if (!rotated) {
+    spdlog::throw_spdlog_ex("rotating_sqllite_sink: failed renaming " +
+                                spdlog::details::os::filename_to_str(base_filename_),
+                            errno);
+  }
+}
+
+template <typename Mutex>
+VTPL_INLINE rotating_sqllite_sink<Mutex>::~rotating_sqllite_sink()
+{
+  // Never throw from here: a COMMIT failing with SQLITE_BUSY or a full disk would
+  // terminate the program. close() retries the COMMIT without throwing.
+  try {
+    flush_();
+  } catch (const std::exception& ex) {
+    std::fprintf(stderr, "rotating_sqllite_sink: flush failed on close: %s\n", ex.what());
+  }
 }
 
 template <typename Mutex>
@@ -126,7 +158,6 @@ VTPL_INLINE void rotating_sqllite_sink<Mutex>::rotate_()
       spdlog::details::os::sleep_for_millis(100);
       if (!rename_file_(src, target)) {
         file_sqllite_helper_.reopen(true); // truncate the log file anyway to prevent it to grow beyond its limit!
-        current_size_ = 0;
         spdlog::throw_spdlog_ex(
             "rotating_sqllite_sink: failed renaming " + filename_to_str(src) + " to " + filename_to_str(target), errno);
       }
@@ -135,6 +166,70 @@ VTPL_INLINE void rotating_sqllite_sink<Mutex>::rotate_()
   file_sqllite_helper_.reopen(true);
 }
 
+template <typename Mutex>
+VTPL_INLINE bool rotating_sqllite_sink<Mutex>::rotate_in_background_()
+{
+  using vtpl::details::rotation_worker;
+  namespace os = spdlog::details::os;
+
+  // Leave the WAL to be checkpointed by the worker.
+  file_sqllite_helper_.close(false);
+  const spdlog::filename_t pending = rotation_worker::new_pending_filename(base_filename_);
+  (void)os::remove_if_exists(pending + SPDLOG_FILENAME_T("-wal"));
+  if (os::rename(base_filename_, pending) != 0) {
+    // Keep writing to the full database, try again after max_size_ more bytes.
+    file_sqllite_helper_.open(base_filename_);
+    rotate_at_ = file_sqllite_helper_.exact_size() + max_size_;
+    return false;
+  }
+  (void)os::rename(base_filename_ + SPDLOG_FILENAME_T("-wal"), pending + SPDLOG_FILENAME_T("-wal"));
+  (void)os::remove_if_exists(base_filename_ + SPDLOG_FILENAME_T("-shm"));
+  const spdlog::filename_t next = rotation_worker::next_filename(base_filename_);
+  if (os::path_exists(next)) {
+    (void)os::rename(next, base_filename_);
+  }
+  file_sqllite_helper_.open(base_filename_);
+  rotate_at_ = max_size_;
+
+  const spdlog::filename_t base_filename = base_filename_;
+  const std::size_t max_files = max_files_;
+  const vtpl::sqllite_options options = file_sqllite_helper_.options();
+  rotation_worker::instance().post([base_filename, pending, next, max_files, options] {
+    {
+      // Fold the WAL into the database before it is renamed again.
+      vtpl::details::file_sqllite_helper full({}, options);
+      full.open(pending);
+      full.sync();
+    }
+    rotation_worker::shift_files(base_filename, pending, max_files, options.compression);
+    // Create the next database under another name, so it only appears once complete.
+    const spdlog::filename_t preparing = rotation_worker::pending_filename(next, 0);
+    {
+      vtpl::details::file_sqllite_helper prepared({}, options);
+      prepared.open(preparing, true);
+    }
+    (void)os::remove_if_exists(next);
+    (void)os::rename(preparing, next);
+  });
+  return true;
+}
+
+template <typename Mutex>
+VTPL_INLINE void rotating_sqllite_sink<Mutex>::recover_pending_files_(const spdlog::filename_t& base_filename,
+                                                                      std::size_t max_files,
+                                                                      const vtpl::sqllite_options& options)
+{
+  using vtpl::details::rotation_worker;
+  for (const auto& leftover : rotation_worker::leftover_pending_files(base_filename)) {
+    {
+      vtpl::details::file_sqllite_helper full({}, options);
+      full.open(leftover);
+      full.sync();
+    }
+    rotation_worker::shift_files(base_filename, leftover, max_files, options.compression);
+  }
+}
+
 // delete the target if exists, and rename the src file  to target
 // return true on success, false otherwise.
 template <typename Mutex>
@@ -6,12 +6,12 @@
 #define rotating_sqllite_sink_h
 #include "common.h"
 #include "details/file_sqllite_helper.h"
+#include "details/rotation_worker.h"
 #include <spdlog/details/null_mutex.h>
 #include <spdlog/details/synchronous_factory.h>
 #include <spdlog/sinks/base_sink.h>
 
 #include <chrono>
-#include <iostream>
 #include <mutex>
 #include <string>
 
@@ -19,16 +19,23 @@ namespace vtpl
 {
 namespace sinks
 {
+// Rotating sink that stores every message as one row of an sqlite database,
+// with its fields in separate columns (see details::file_sqllite_helper), so the
+// logs can be queried by time, level or source through the indexes selected in
+// sqllite_options. The pattern formatter of the sink is not used.
+// With sqllite_options::background_rotation the rename cascade runs on the
+// rotation_worker thread, see background_rotating_file_sink.
 template <typename Mutex>
 class rotating_sqllite_sink : public spdlog::sinks::base_sink<Mutex>
 {
 public:
   rotating_sqllite_sink(spdlog::filename_t base_filename, std::size_t max_size, std::size_t max_files,
-                        bool rotate_on_open = false, const vtpl::sqllite_event_handlers& event_handlers = {});
+                        bool rotate_on_open = false, const vtpl::sqllite_event_handlers& event_handlers = {},
+                        const vtpl::sqllite_options& options = {});
   static spdlog::filename_t calc_filename(const spdlog::filename_t& filename, std::size_t index);
   spdlog::filename_t filename();
 
-  ~rotating_sqllite_sink() { flush_(); }
+  ~rotating_sqllite_sink() override;
 
 protected:
   void sink_it_(const spdlog::details::log_msg& msg) override;
@@ -42,6 +49,15 @@ private:
   // log.3.txt -> delete
   void rotate_();
 
+  // Swap the active database for the prepared one and hand the full one, with
+  // its WAL, to the rotation worker. Returns false if it could not be renamed.
+  bool rotate_in_background_();
+
+  // Fold the WAL of each pending database left by a process that died during a
+  // background rotation into it, and shift it into the rotation.
+  static void recover_pending_files_(const spdlog::filename_t& base_filename, std::size_t max_files,
+                                     const vtpl::sqllite_options& options);
+
   // delete the target if exists, and rename the src file  to target
   // return true on success, false otherwise.
   bool rename_file_(const spdlog::filename_t& src_filename, const spdlog::filename_t& target_filename);
@@ -49,7 +65,8 @@ private:
   spdlog::filename_t base_filename_;
   std::size_t max_size_;
   std::size_t max_files_;
-  std::size_t current_size_;
+  // Size at which to rotate: max_size_, or further away after a failed background rotation.
+  std::size_t rotate_at_;
   vtpl::details::file_sqllite_helper file_sqllite_helper_;
 };
 
@@ -63,19 +80,21 @@ template <typename Factory = spdlog::synchronous_factory>
 inline std::shared_ptr<spdlog::logger>
 rotating_sqllite_logger_mt(const std::string& logger_name, const spdlog::filename_t& filename, size_t max_file_size,
                            size_t max_files, bool rotate_on_open = false,
-                           const vtpl::sqllite_event_handlers& event_handlers = {})
+                           const vtpl::sqllite_event_handlers& event_handlers = {},
+                           const vtpl::sqllite_options& options = {})
 {
   return Factory::template create<vtpl::sinks::rotating_sqllite_sink_mt>(logger_name, filename, max_file_size, max_files,
-                                                                   rotate_on_open, event_handlers);
+                                                                   rotate_on_open, event_handlers, options);
 }
 template <typename Factory = spdlog::synchronous_factory>
 inline std::shared_ptr<spdlog::logger>
 rotating_sqllite_logger_st(const std::string& logger_name, const spdlog::filename_t& filename, size_t max_file_size,
                            size_t max_files, bool rotate_on_open = false,
-                           const vtpl::sqllite_event_handlers& event_handlers = {})
+                           const vtpl::sqllite_event_handlers& event_handlers = {},
+                           const vtpl::sqllite_options& options = {})
 {
   return Factory::template create<vtpl::sinks::rotating_sqllite_sink_st>(logger_name, filename, max_file_size, max_files,
-                                                                   rotate_on_open, event_handlers);
+                                                                   rotate_on_open, event_handlers, options);
 }
 } // namespace vtpl
 #ifdef VTPL_HEADER_ONLY
@@ -24,22 +24,42 @@
    René Nyffenegger rene.nyffenegger@adp-gmbh.ch
 */
 #include "Chameleon.h"
+#include <cctype>
+#include <charconv>
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
-#include <sstream>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
 
-Chameleon::Chameleon(std::string value) : value_(std::move(value)) {}
-
-Chameleon::Chameleon(const char* c) : value_(c) {}
+/// `d` as `std::ostream << d` writes it in the classic locale, without a stream.
+static std::string FormatNumber(double d) {
+  char       buffer[32];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), d, std::chars_format::general, 6);
+  return std::string(buffer, result.ptr);
+}
 
-Chameleon::Chameleon(double d) {
-  std::stringstream s;
-  s << d;
-  value_ = s.str();
+static bool EqualsIgnoreCase(std::string_view text, std::string_view word) {
+  if (text.size() != word.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(text[i])) != word[i]) {
+      return false;
+    }
+  }
+  return true;
 }
 
+Chameleon::Chameleon(std::string value) : value_(std::move(value)) { Parse(); }
+
+Chameleon::Chameleon(const char* c) : value_(c) { Parse(); }
+
+Chameleon::Chameleon(double d) : value_(FormatNumber(d)) { Parse(); }
+
 // Chameleon::Chameleon(Chameleon const& other) : value_(other.value_) {}
 
 // Chameleon& Chameleon::operator=(Chameleon const& other)
@@ -49,17 +69,66 @@ Chameleon::Chameleon(double d) {
 // }
 
 Chameleon& Chameleon::operator=(double i) {
-  std::stringstream s;
-  s << i;
-  value_ = s.str();
+  value_ = FormatNumber(i);
+  Parse();
   return *this;
 }
 
 Chameleon& Chameleon::operator=(std::string const& s) {
   value_ = s;
+  Parse();
   return *this;
 }
 
 Chameleon::operator std::string() const { return value_; }
 
-Chameleon::operator double() const { return std::atof(value_.c_str()); }
\ No newline at end of file
+void Chameleon::Parse() {
+  const char* first = value_.data();
+  const char* last  = first + value_.size();
+  // Like std::atof, skip leading blanks and a '+', which std::from_chars does not take.
+  while (first != last && std::isspace(static_cast<unsigned char>(*first))) {
+    ++first;
+  }
+  const char* digits   = first;
+  const bool  negative = digits != last && *digits == '-';
+  if (digits != last && (*digits == '-' || *digits == '+')) {
+    ++digits;
+  }
+
+  number_ = 0;
+  std::from_chars_result parsed{digits, std::errc::invalid_argument};
+  if (digits == last || *digits == '-') {
+    // Nothing, or a second sign.
+  } else if (last - digits > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+    parsed = std::from_chars(digits + 2, last, number_, std::chars_format::hex);
+  } else {
+    parsed = std::from_chars(digits, last, number_);
+  }
+  const bool is_number = parsed.ec != std::errc::invalid_argument;
+  if (parsed.ec == std::errc::result_out_of_range) {
+    number_ = std::strtod(first, nullptr);
+  } else if (negative && is_number) {
+    number_ = -number_;
+  }
+
+  int64_t    integer = 0;
+  const auto exact   = std::from_chars(negative ? digits - 1 : digits, last, integer);
+  if (is_number && exact.ec == std::errc() && exact.ptr == parsed.ptr) {
+    integer_ = integer;
+  } else if (std::isnan(number_)) {
+    integer_ = 0;
+  } else if (number_ <= static_cast<double>(std::numeric_limits<int64_t>::min())) {
+    integer_ = std::numeric_limits<int64_t>::min();
+  } else if (number_ >= static_cast<double>(std::numeric_limits<int64_t>::max())) {
+    integer_ = std::numeric_limits<int64_t>::max();
+  } else {
+    integer_ = static_cast<int64_t>(number_);
+  }
+
+  if (is_number) {
+    boolean_ = number_ != 0;
+  } else {
+    const std::string_view text(first, static_cast<size_t>(last - first));
+    boolean_ = EqualsIgnoreCase(text, "true") || EqualsIgnoreCase(text, "yes") || EqualsIgnoreCase(text, "on");
+  }
+}
@@ -2,13 +2,31 @@
 
 #include "ConfigFile.h"
 #include "Chameleon.h"
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <exception>
 #include <file_utilities.h>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
 #include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
 
 class ConfigSectionException : public std::exception {
   [[nodiscard]] const char* what() const noexcept override { return "section does not exist"; }
@@ -17,120 +35,377 @@ class ConfigSectionException : public std::exception {
 class ConfigEntryException : public std::exception {
   [[nodiscard]] const char* what() const noexcept override { return "entry does not exist"; }
 };
-std::string Trim(std::string const& source, char const* delims = " \t\r\n") {
-  std::string            result(source);
-  std::string::size_type index = result.find_last_not_of(delims);
-  if (index != std::string::npos) {
-    result.erase(++index);
+/// Exclusive lock on a file, held by writers of the configuration file next to it.
+/// Without the file, for instance in a read-only directory, nothing is locked.
+class ConfigFileLock {
+public:
+  explicit ConfigFileLock(const std::string& path) {
+#ifdef _WIN32
+    handle_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                          OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle_ != INVALID_HANDLE_VALUE) {
+      OVERLAPPED overlapped{};
+      LockFileEx(handle_, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped);
+    }
+#else
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ >= 0) {
+      flock(fd_, LOCK_EX);
+    }
+#endif
+  }
+  ~ConfigFileLock() {
+    // Closing the file releases the lock.
+#ifdef _WIN32
+    if (handle_ != INVALID_HANDLE_VALUE) {
+      CloseHandle(handle_);
+    }
+#else
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+#endif
+  }
+  ConfigFileLock(const ConfigFileLock&)            = delete;
+  ConfigFileLock& operator=(const ConfigFileLock&) = delete;
+
+private:
+#ifdef _WIN32
+  HANDLE handle_;
+#else
+  int fd_;
+#endif
+};
+
+/// Replace `path` with `content`, through a temporary file flushed to disk before
+/// it is renamed, so a crash leaves the old file or the new one.
+static bool WriteAtomically(const std::string& path, const std::string& content) {
+  const std::string temporary = path + ".tmp";
+  std::FILE*        file      = std::fopen(temporary.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
   }
+  bool written = std::fwrite(content.data(), 1, content.size(), file) == content.size() && std::fflush(file) == 0;
+#ifdef _WIN32
+  written = written && _commit(_fileno(file)) == 0;
+#else
+  written = written && fsync(fileno(file)) == 0;
+#endif
+  written = std::fclose(file) == 0 && written;
 
-  index = result.find_first_not_of(delims);
-  if (index != std::string::npos) {
-    result.erase(0, index);
-  } else {
-    result.erase();
+  std::error_code error;
+  if (written) {
+    std::filesystem::rename(temporary, path, error);
+  }
+  if (!written || error) {
+    std::filesystem::remove(temporary, error);
+    return false;
   }
-  return result;
+#ifndef _WIN32
+  // Make the rename itself durable.
+  const std::string directory = std::filesystem::path(path).parent_path().string();
+  const int         fd        = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+#endif
+  return true;
 }
 
-ConfigFile::ConfigFile(std::string config_file) : configFile_(std::move(config_file)) {
-  std::ifstream file(configFile_.c_str());
-  if (file.is_open()) {
-    std::string line;
-    std::string name;
-    std::string value;
-    std::string in_section;
-    size_t      pos_equal = 0;
-    while (std::getline(file, line)) {
+/// `source` without the `delims` at either end.
+static std::string_view Trim(std::string_view source, std::string_view delims = " \t\r\n") {
+  const std::string_view::size_type first = source.find_first_not_of(delims);
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  return source.substr(first, source.find_last_not_of(delims) - first + 1);
+}
 
-      if (line.empty()) {
-        continue;
-      }
+static size_t Hash(std::string_view section, std::string_view name) {
+  const size_t hash = std::hash<std::string_view>()(section);
+  return hash ^ (std::hash<std::string_view>()(name) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
 
-      if (line[0] == '#') {
-        continue;
-      }
-      if (line[0] == ';') {
-        continue;
-      }
+/// `entries` in the order they are written to the file.
+static void SortByKey(std::vector<const ConfigFile::Entry*>& entries) {
+  std::sort(entries.begin(), entries.end(), [](const ConfigFile::Entry* a, const ConfigFile::Entry* b) {
+    return a->section < b->section || (a->section == b->section && a->name < b->name);
+  });
+}
 
-      if (line[0] == '[') {
-        in_section = Trim(line.substr(1, line.find(']') - 1));
-        continue;
-      }
+ConfigFile::ConfigFile(std::string config_file) : slots_(16), configFile_(std::move(config_file)) { Load(); }
 
-      pos_equal = line.find('=');
-      name      = Trim(line.substr(0, pos_equal));
-      value     = Trim(line.substr(pos_equal + 1));
-      sections_[in_section].insert(std::make_pair(name, Chameleon(value)));
-      // content_[inSection + '/' + name] = Chameleon(value);
+void ConfigFile::Load() {
+  std::ifstream file(configFile_.c_str(), std::ios::binary);
+  if (!file.is_open()) {
+    need_to_save_++;
+    return;
+  }
+  file.seekg(0, std::ios::end);
+  const std::streamoff size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  if (size > 0) {
+    text_.resize(static_cast<size_t>(size));
+    file.read(text_.data(), size);
+    text_.resize(static_cast<size_t>(file.gcount()));
+  }
+
+  const std::string_view text(text_);
+  // Room for an entry on every line, so the table is not rebuilt while parsing.
+  const size_t lines    = static_cast<size_t>(std::count(text.begin(), text.end(), '\n')) + 1;
+  size_t       capacity = slots_.size();
+  while (capacity < 2 * lines) {
+    capacity *= 2;
+  }
+  Rehash(capacity);
+
+  std::string_view in_section;
+  bool             section_known = false;
+  size_t           begin         = 0;
+  while (begin < text.size()) {
+    size_t end = text.find('\n', begin);
+    if (end == std::string_view::npos) {
+      end = text.size();
+    }
+    // Trimmed, so a CRLF line or one of blanks is empty too.
+    const std::string_view line = Trim(text.substr(begin, end - begin));
+    begin                       = end + 1;
+
+    if (line.empty()) {
+      continue;
+    }
+
+    if (line[0] == '#') {
+      continue;
+    }
+    if (line[0] == ';') {
+      continue;
+    }
+
+    if (line[0] == '[') {
+      in_section    = Trim(line.substr(1, line.find(']') - 1));
+      section_known = false;
+      continue;
     }
+
+    // Without '=' the whole line is both name and value.
+    const size_t pos_equal = line.find('=');
+    const auto   name      = Trim(line.substr(0, pos_equal));
+    const auto   value     = Trim(pos_equal != std::string_view::npos ? line.substr(pos_equal + 1) : line);
+    // Of repeated entries the first one read is kept.
+    const size_t slot = Slot(in_section, name);
+    if (slots_[slot] == 0) {
+      Insert(slot, in_section, name, Chameleon(std::string(value)));
+      if (!section_known) {
+        sections_.insert(in_section);
+        section_known = true;
+      }
+    }
+  }
+  saved_entries_ = entries_.size();
+}
+
+ConfigFile::ConfigFile(const ConfigFile& other)
+    : text_(other.text_), names_(other.names_), entries_(other.entries_), saved_entries_(other.saved_entries_),
+      slots_(other.slots_), configFile_(other.configFile_), need_to_save_(other.need_to_save_) {
+  Repoint(other.text_, other.names_);
+}
+
+ConfigFile::ConfigFile(ConfigFile&& other) : slots_(16) { MoveFrom(other); }
+
+ConfigFile& ConfigFile::operator=(const ConfigFile& other) {
+  if (this != &other) {
+    ConfigFile copy(other);
+    MoveFrom(copy);
+  }
+  return *this;
+}
+
+ConfigFile& ConfigFile::operator=(ConfigFile&& other) {
+  if (this != &other) {
+    MoveFrom(other);
+  }
+  return *this;
+}
+
+void ConfigFile::MoveFrom(ConfigFile& other) {
+  // A moved deque keeps its elements in place, a moved string may not: short
+  // text lives inside the string object.
+  const char* const old_data = other.text_.data();
+  text_                      = std::move(other.text_);
+  names_                     = std::move(other.names_);
+  entries_                   = std::move(other.entries_);
+  saved_entries_             = other.saved_entries_;
+  slots_                     = std::move(other.slots_);
+  configFile_                = std::move(other.configFile_);
+  need_to_save_              = other.need_to_save_;
+  sections_.clear();
+  if (text_.data() != old_data) {
+    Repoint(std::string_view(old_data, text_.size()), {});
   } else {
-    need_to_save_++;
+    sections_ = std::move(other.sections_);
+  }
+  other.text_.clear();
+  other.names_.clear();
+  other.entries_.clear();
+  other.slots_.assign(16, 0);
+  other.sections_.clear();
+  other.DiscardChanges();
+}
+
+void ConfigFile::Repoint(std::string_view old_text, const std::deque<std::string>& old_names) {
+  std::unordered_map<const char*, std::string_view> names;
+  names.reserve(old_names.size());
+  for (size_t index = 0; index < old_names.size(); ++index) {
+    names.emplace(old_names[index].data(), names_[index]);
+  }
+  const auto repoint = [&](std::string_view name) {
+    const std::less_equal<const char*> before;
+    if (name.data() != nullptr && before(old_text.data(), name.data()) &&
+        before(name.data(), old_text.data() + old_text.size())) {
+      return std::string_view(text_.data() + (name.data() - old_text.data()), name.size());
+    }
+    const auto it = names.find(name.data());
+    return it != names.end() ? it->second : name;
+  };
+  sections_.clear();
+  for (Entry& entry : entries_) {
+    entry.section = repoint(entry.section);
+    entry.name    = repoint(entry.name);
+    sections_.insert(entry.section);
   }
 }
 
-ConfigFile::~ConfigFile() {
-  if (need_to_save_ > 0) {
+ConfigFile::~ConfigFile() { Save(); }
+
+bool ConfigFile::Save() {
+  if (need_to_save_ == 0) {
+    return true;
+  }
+  vtpl::utilities::create_directories_from_file_path(configFile_);
+  ConfigFileLock lock(configFile_ + ".lock");
+
+  // Entries written by others since Load() are kept, and win over our defaults.
+  ConfigFile current(configFile_);
+  // Whatever happens, `current` must not save itself: its destructor would wait for our lock.
+  struct DiscardOnExit {
+    ConfigFile& file;
+    ~DiscardOnExit() { file.DiscardChanges(); }
+  } discard{current};
+  for (size_t index = saved_entries_; index < entries_.size(); ++index) {
+    current.TryEmplace(entries_[index].section, entries_[index].name, entries_[index].value);
+  }
+  if (current.NeedsSave()) {
     std::cout << "Saving configuration file to " << configFile_.c_str() << '\n';
-    vtpl::utilities::create_directories_from_file_path(configFile_);
-    std::ofstream file(configFile_.c_str());
-    if (file.is_open()) {
-      // std::string name;
-      // std::string value;
-      std::string in_section;
-      for (auto& section : sections_) {
-        in_section = section.first;
-        file << "[" << in_section << "]" << '\n';
-        file << '\n';
-        for (auto& it1 : section.second) {
-          file << it1.first << " = " << it1.second << '\n';
-        }
-        file << '\n';
-      }
-    } else {
+    if (!WriteAtomically(configFile_, current.Serialize())) {
       std::cout << "!!! Could not save [check the directory seperator] configuration file to " << configFile_.c_str()
                 << '\n';
+      return false;
     }
   }
+  DiscardChanges();
+  return true;
 }
 
-Chameleon const& ConfigFile::Value(std::string const& section, std::string const& entry) const {
-  auto ci = sections_.find(section);
-  if (ci == sections_.end()) {
-    throw ConfigSectionException();
+std::string ConfigFile::Serialize() const {
+  std::vector<const Entry*> entries;
+  entries.reserve(entries_.size());
+  for (const Entry& entry : entries_) {
+    entries.push_back(&entry);
   }
-  auto ci1 = ci->second.find(entry);
-  if (ci1 == ci->second.end()) {
-    throw ConfigEntryException();
+  SortByKey(entries);
+
+  std::string content;
+  for (auto it = entries.begin(); it != entries.end();) {
+    const std::string_view in_section = (*it)->section;
+    content.append("[").append(in_section).append("]\n");
+    content.append("\n");
+    for (; it != entries.end() && (*it)->section == in_section; ++it) {
+      content.append((*it)->name).append(" = ").append((*it)->value.Text()).append("\n");
+    }
+    content.append("\n");
   }
-  return ci1->second;
+  return content;
 }
 
-Chameleon const& ConfigFile::Value(std::string const& section, std::string const& entry, double value) {
-  try {
-    return Value(section, entry);
-  } catch (ConfigSectionException&) {
-    sections_[section].insert(std::make_pair(entry, Chameleon(value)));
-    need_to_save_++;
-    return Value(section, entry);
-  } catch (ConfigEntryException&) { // section found but entry not found
-    sections_[section].insert(std::make_pair(entry, Chameleon(value)));
-    need_to_save_++;
-    return Value(section, entry);
+size_t ConfigFile::Slot(std::string_view section, std::string_view entry) const {
+  const size_t mask = slots_.size() - 1;
+  for (size_t slot = Hash(section, entry) & mask;; slot = (slot + 1) & mask) {
+    const uint32_t index = slots_[slot];
+    if (index == 0) {
+      return slot;
+    }
+    const Entry& it = entries_[index - 1];
+    if (it.name == entry && it.section == section) {
+      return slot;
+    }
   }
 }
 
-Chameleon const& ConfigFile::Value(std::string const& section, std::string const& entry, std::string const& value) {
-  try {
-    return Value(section, entry);
-  } catch (ConfigSectionException&) {
-    sections_[section].insert(std::make_pair(entry, Chameleon(value)));
-    need_to_save_++;
-    return Value(section, entry);
-  } catch (ConfigEntryException&) { // section found but entry not found
-    sections_[section].insert(std::make_pair(entry, Chameleon(value)));
-    need_to_save_++;
-    return Value(section, entry);
+void ConfigFile::Rehash(size_t capacity) {
+  slots_.assign(capacity, 0);
+  for (size_t index = 0; index < entries_.size(); ++index) {
+    slots_[Slot(entries_[index].section, entries_[index].name)] = static_cast<uint32_t>(index + 1);
+  }
+}
+
+ConfigFile::Entry& ConfigFile::Insert(size_t slot, std::string_view section, std::string_view entry,
+                                      Chameleon value) {
+  entries_.push_back(Entry{section, entry, std::move(value)});
+  slots_[slot] = static_cast<uint32_t>(entries_.size());
+  if (2 * entries_.size() > slots_.size()) {
+    Rehash(2 * slots_.size());
+  }
+  return entries_.back();
+}
+
+const Chameleon* ConfigFile::Find(std::string_view section, std::string_view entry) const {
+  const uint32_t index = slots_[Slot(section, entry)];
+  return index != 0 ? &entries_[index - 1].value : nullptr;
+}
+
+bool ConfigFile::HasSection(std::string_view section) const { return sections_.find(section) != sections_.end(); }
+
+Chameleon const& ConfigFile::Value(std::string_view section, std::string_view entry) const {
+  const Chameleon* value = Find(section, entry);
+  if (value != nullptr) {
+    return *value;
+  }
+  if (!HasSection(section)) {
+    throw ConfigSectionException();
   }
-}
\ No newline at end of file
+  throw ConfigEntryException();
+}
+
+std::vector<const ConfigFile::Entry*> ConfigFile::Entries(std::string_view section) const {
+  std::vector<const Entry*> entries;
+  if (!HasSection(section)) {
+    return entries;
+  }
+  for (const Entry& entry : entries_) {
+    if (entry.section == section) {
+      entries.push_back(&entry);
+    }
+  }
+  SortByKey(entries);
+  return entries;
+}
+
+Chameleon const& ConfigFile::Add(size_t slot, std::string_view section, std::string_view entry, Chameleon value) {
+  // Share the name of the section with its other entries.
+  auto it = sections_.find(section);
+  if (it == sections_.end()) {
+    it = sections_.insert(names_.emplace_back(section)).first;
+  }
+  need_to_save_++;
+  return Insert(slot, *it, names_.emplace_back(entry), std::move(value)).value;
+}
+
+Chameleon const& ConfigFile::Value(std::string_view section, std::string_view entry, double value) {
+  return *TryEmplace(section, entry, value).first;
+}
+
+Chameleon const& ConfigFile::Value(std::string_view section, std::string_view entry, std::string const& value) {
+  return *TryEmplace(section, entry, value).first;
+}
@@ -0,0 +1,131 @@
+#include "SharedConfigFile.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/// Position in `added` of the first entry not ordered before (section, entry).
+template <typename Entries>
+static auto LowerBound(Entries& added, std::string_view section, std::string_view entry) {
+  return std::lower_bound(added.begin(), added.end(), section, [entry](const auto* it, std::string_view key) {
+    return it->section < key || (it->section == key && it->name < entry);
+  });
+}
+
+const Chameleon* SharedConfigFile::Snapshot::Find(std::string_view section, std::string_view entry) const {
+  const Chameleon* value = file->Find(section, entry);
+  if (value != nullptr || added.empty()) {
+    return value;
+  }
+  auto it = LowerBound(added, section, entry);
+  if (it != added.end() && (*it)->section == section && (*it)->name == entry) {
+    return &(*it)->value;
+  }
+  return nullptr;
+}
+
+SharedConfigFile::SharedConfigFile(std::string config_file) : configFile_(std::move(config_file)) {
+  auto snapshot     = std::make_shared<Snapshot>();
+  snapshot->file    = Read(snapshot->missing);
+  snapshot->storage = std::make_shared<std::deque<Added>>();
+  Publish(std::move(snapshot));
+}
+
+SharedConfigFile::~SharedConfigFile() { Save(); }
+
+std::shared_ptr<const ConfigFile> SharedConfigFile::Read(bool& missing) const {
+  auto file = std::make_shared<ConfigFile>(configFile_);
+  missing   = file->NeedsSave();
+  file->DiscardChanges();
+  return file;
+}
+
+std::shared_ptr<const SharedConfigFile::Snapshot> SharedConfigFile::Current() const {
+  return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
+}
+
+void SharedConfigFile::Publish(std::shared_ptr<const Snapshot> snapshot) {
+  std::atomic_store_explicit(&snapshot_, std::move(snapshot), std::memory_order_release);
+}
+
+std::optional<Chameleon> SharedConfigFile::Find(std::string_view section, std::string_view entry) const {
+  const std::shared_ptr<const Snapshot> snapshot = Current();
+  const Chameleon*                      value    = snapshot->Find(section, entry);
+  if (value == nullptr) {
+    return std::nullopt;
+  }
+  return *value;
+}
+
+Chameleon SharedConfigFile::Value(std::string_view section, std::string_view entry, double value) {
+  if (std::optional<Chameleon> found = Find(section, entry)) {
+    return *std::move(found);
+  }
+  return GetOrAdd(section, entry, Chameleon(value));
+}
+
+Chameleon SharedConfigFile::Value(std::string_view section, std::string_view entry, std::string const& value) {
+  if (std::optional<Chameleon> found = Find(section, entry)) {
+    return *std::move(found);
+  }
+  return GetOrAdd(section, entry, Chameleon(value));
+}
+
+Chameleon SharedConfigFile::GetOrAdd(std::string_view section, std::string_view entry, Chameleon value) {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  // Another thread may have added it since the lock-free lookup.
+  const std::shared_ptr<const Snapshot> snapshot = Current();
+  if (const Chameleon* found = snapshot->Find(section, entry)) {
+    return *found;
+  }
+  // Readers of older snapshots only use the entries they index, which the deque
+  // does not move.
+  snapshot->storage->push_back(Added{std::string(section), std::string(entry), value});
+  auto next = std::make_shared<Snapshot>(*snapshot);
+  next->added.insert(LowerBound(next->added, section, entry), &next->storage->back());
+  Publish(std::move(next));
+  return value;
+}
+
+bool SharedConfigFile::NeedsSave() const {
+  const std::shared_ptr<const Snapshot> snapshot = Current();
+  return snapshot->missing || !snapshot->added.empty();
+}
+
+bool SharedConfigFile::Save() {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  const std::shared_ptr<const Snapshot> snapshot = Current();
+  if (!snapshot->missing && snapshot->added.empty()) {
+    return true;
+  }
+  auto file = std::make_shared<ConfigFile>(configFile_);
+  for (const Added* added : snapshot->added) {
+    file->TryEmplace(added->section, added->name, added->value);
+  }
+  if (!file->Save()) {
+    file->DiscardChanges();
+    return false;
+  }
+  auto next     = std::make_shared<Snapshot>();
+  next->file    = std::move(file);
+  next->storage = std::make_shared<std::deque<Added>>();
+  Publish(std::move(next));
+  return true;
+}
+
+void SharedConfigFile::Reload() {
+  std::lock_guard<std::mutex> lock(writer_mutex_);
+  const std::shared_ptr<const Snapshot> snapshot = Current();
+
+  auto next     = std::make_shared<Snapshot>();
+  next->file    = Read(next->missing);
+  next->storage = snapshot->storage;
+  for (const Added* added : snapshot->added) {
+    if (next->file->Find(added->section, added->name) == nullptr) {
+      next->added.push_back(added);
+    }
+  }
+  Publish(std::move(next));
+}
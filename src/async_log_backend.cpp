@@ -0,0 +1,200 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#include "details/async_log_backend.h"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/details/os.h>
+#include <utility>
+
+namespace ray {
+
+// How long the writer sleeps when idle before checking the queue again, in case
+// a wake-up was missed.
+constexpr std::chrono::milliseconds kIdleWait(50);
+
+/// Reaches the protected write path of spdlog::logger, so a queued record goes
+/// through the level check, backtrace, sink loop and error handler of
+/// logger::log() while keeping the time and thread id of the caller.
+struct LoggerWriter : spdlog::logger {
+  static void Write(spdlog::logger& logger, const spdlog::details::log_msg& msg) {
+    (logger.*&LoggerWriter::log_it_)(msg, logger.should_log(msg.level), logger.should_backtrace());
+  }
+};
+
+AsyncLogBackend::AsyncLogBackend(std::shared_ptr<spdlog::logger> logger, size_t queue_size,
+                                 RayLogOverflowPolicy overflow_policy)
+    : logger_(std::move(logger)), overflow_policy_(overflow_policy), queue_(queue_size),
+      worker_([this] { WorkerLoop(); }) {}
+
+AsyncLogBackend::~AsyncLogBackend() { Stop(); }
+
+bool AsyncLogBackend::Post(spdlog::level::level_enum level, spdlog::string_view_t payload,
+                           const spdlog::source_loc& source) {
+  return PostRecord(level, [&](AsyncLogRecord& record) {
+    record.deferred = false;
+    record.source   = source;
+    record.payload.clear();
+    record.payload.append(payload.data(), payload.data() + payload.size());
+  });
+}
+
+bool AsyncLogBackend::PostDeferred(spdlog::level::level_enum level, const DeferredLogFormat& format,
+                                   spdlog::string_view_t args) {
+  return PostRecord(level, [&](AsyncLogRecord& record) {
+    record.deferred = true;
+    record.format   = format;
+    record.payload.clear();
+    record.payload.append(args.data(), args.data() + args.size());
+  });
+}
+
+template <typename Fill> bool AsyncLogBackend::PostRecord(spdlog::level::level_enum level, Fill&& fill) {
+  const auto now       = spdlog::log_clock::now();
+  const auto thread_id = spdlog::details::os::thread_id();
+  auto       fill_all  = [&](AsyncLogRecord& record) {
+    record.level     = level;
+    record.time      = now;
+    record.thread_id = thread_id;
+    fill(record);
+  };
+
+  int spins = 0;
+  while (!stopped_.load(std::memory_order_acquire)) {
+    if (queue_.try_enqueue(fill_all)) {
+      posted_.fetch_add(1, std::memory_order_release);
+      if (stopped_.load(std::memory_order_acquire)) {
+        // Lost the race with Stop(): the writer may already have done its last drain.
+        while (queue_.try_dequeue([this](AsyncLogRecord& record) { Write(record); })) {
+          retired_.fetch_add(1, std::memory_order_release);
+        }
+      } else if (worker_sleeping_.load(std::memory_order_seq_cst)) {
+        WakeWorker();
+      }
+      return true;
+    }
+    switch (overflow_policy_) {
+    case RayLogOverflowPolicy::DROP_NEWEST:
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    case RayLogOverflowPolicy::DROP_OLDEST:
+      if (queue_.try_dequeue([](AsyncLogRecord&) {})) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        retired_.fetch_add(1, std::memory_order_release);
+      }
+      break;
+    case RayLogOverflowPolicy::BLOCK:
+    default:
+      WakeWorker();
+      if (++spins < 16) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+      break;
+    }
+  }
+
+  // The writer thread is gone, write through on the calling thread.
+  AsyncLogRecord record;
+  fill_all(record);
+  Write(record);
+  return true;
+}
+
+void AsyncLogBackend::Drain() {
+  if (stopped_.load(std::memory_order_acquire)) {
+    logger_->flush();
+    return;
+  }
+  const uint64_t target = posted_.load(std::memory_order_acquire);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_cv_.notify_one();
+    drained_cv_.wait(lock, [&] {
+      return retired_.load(std::memory_order_acquire) >= target || stopped_.load(std::memory_order_acquire);
+    });
+  }
+  logger_->flush();
+}
+
+void AsyncLogBackend::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_requested_) {
+      return;
+    }
+    stop_requested_ = true;
+  }
+  wake_cv_.notify_one();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void AsyncLogBackend::WakeWorker() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  wake_cv_.notify_one();
+}
+
+void AsyncLogBackend::Write(const AsyncLogRecord& record) {
+  spdlog::string_view_t payload(record.payload.data(), record.payload.size());
+  spdlog::source_loc    source = record.source;
+  fmt::memory_buffer    rendered;
+  if (record.deferred) {
+    RenderDeferredLog(record.format, record.payload.data(), rendered);
+    payload = spdlog::string_view_t(rendered.data(), rendered.size());
+    source  = spdlog::source_loc(record.format.site->Basename(), record.format.site->Line(), nullptr);
+  }
+  spdlog::details::log_msg msg(record.time, source, logger_->name(), record.level, payload);
+  msg.thread_id = record.thread_id;
+  LoggerWriter::Write(*logger_, msg);
+}
+
+void AsyncLogBackend::WorkerLoop() {
+  auto write = [this](AsyncLogRecord& record) {
+    try {
+      Write(record);
+    } catch (const std::exception& ex) {
+      std::cerr << "[ray async logger] failed writing a record: " << ex.what() << '\n';
+    }
+  };
+
+  for (;;) {
+    uint64_t written = 0;
+    while (queue_.try_dequeue(write)) {
+      retired_.fetch_add(1, std::memory_order_release);
+      ++written;
+    }
+
+    // Flushing is left to the flush policy of the sinks.
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (written > 0) {
+      drained_cv_.notify_all();
+      continue;
+    }
+    if (stop_requested_) {
+      // Posts racing with the stop are written synchronously from here on.
+      stopped_.store(true, std::memory_order_release);
+      lock.unlock();
+      while (queue_.try_dequeue(write)) {
+        retired_.fetch_add(1, std::memory_order_release);
+      }
+      logger_->flush();
+      drained_cv_.notify_all();
+      return;
+    }
+    drained_cv_.notify_all();
+    worker_sleeping_.store(true, std::memory_order_seq_cst);
+    if (queue_.size_approx() == 0) {
+      wake_cv_.wait_for(lock, kIdleWait);
+    }
+    worker_sleeping_.store(false, std::memory_order_relaxed);
+  }
+}
+
+} // namespace ray
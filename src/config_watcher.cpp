@@ -0,0 +1,114 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#include "details/config_watcher.h"
+
+#include <exception>
+#include <iostream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace ray {
+
+ConfigFileStamp ConfigFileStamp::Of(const std::string& path) {
+  ConfigFileStamp stamp;
+  std::error_code ec;
+  stamp.mtime = std::filesystem::last_write_time(path, ec);
+  if (!ec) {
+    stamp.size   = std::filesystem::file_size(path, ec);
+    stamp.exists = !ec;
+  }
+  return stamp;
+}
+
+ConfigWatcher& ConfigWatcher::Instance() {
+  static auto* watcher = new ConfigWatcher();
+  return *watcher;
+}
+
+ConfigWatcher::ConfigWatcher() {
+#ifdef __linux__
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+void ConfigWatcher::Watch(const std::string& path, Callback on_change) {
+  std::lock_guard<std::mutex> lock(mutex_);
+#ifdef __linux__
+  if (inotify_fd_ >= 0) {
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    if (dir.empty()) {
+      dir = ".";
+    }
+    // Adding a directory twice returns the same watch, so this is idempotent.
+    (void)inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+  }
+#endif
+  Watched& watched  = files_[path];
+  watched.on_change = std::move(on_change);
+  watched.stamp     = ConfigFileStamp::Of(path);
+  if (!thread_.joinable()) {
+    thread_ = std::thread([this] { Run(); });
+  }
+}
+
+void ConfigWatcher::Unwatch(const std::string& path) {
+  std::lock_guard<std::mutex> callback_lock(callback_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  files_.erase(path);
+}
+
+void ConfigWatcher::WaitForEvents() {
+#ifdef __linux__
+  if (inotify_fd_ >= 0) {
+    pollfd fd{inotify_fd_, POLLIN, 0};
+    if (poll(&fd, 1, static_cast<int>(kPollInterval.count())) > 0) {
+      // Let the writer finish before looking at the file, then discard the
+      // events: every watched file is compared with its stamp anyway.
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      alignas(inotify_event) char buffer[4096];
+      while (read(inotify_fd_, buffer, sizeof(buffer)) > 0) {
+      }
+    }
+    return;
+  }
+#endif
+  std::this_thread::sleep_for(kPollInterval);
+}
+
+void ConfigWatcher::Run() {
+  std::vector<std::pair<std::string, Callback>> changed;
+  for (;;) {
+    WaitForEvents();
+
+    std::lock_guard<std::mutex> callback_lock(callback_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto& it : files_) {
+        const ConfigFileStamp stamp = ConfigFileStamp::Of(it.first);
+        if (stamp != it.second.stamp) {
+          it.second.stamp = stamp;
+          changed.emplace_back(it.first, it.second.on_change);
+        }
+      }
+    }
+    for (auto& it : changed) {
+      try {
+        it.second(it.first);
+      } catch (const std::exception& ex) {
+        std::cerr << "[ray config watcher] failed reloading " << it.first << ": " << ex.what() << '\n';
+      }
+    }
+    changed.clear();
+  }
+}
+
+} // namespace ray
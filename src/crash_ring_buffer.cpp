@@ -0,0 +1,85 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+#include "details/crash_ring_buffer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ray {
+
+CrashRingBuffer* CrashRingBuffer::Open(const std::string& path, size_t capacity) {
+#ifdef _WIN32
+  std::cerr << "[ray crash ring] not supported on this platform, " << path << " not created\n";
+  return nullptr;
+#else
+  if (capacity < kCrashRingSlotSize) {
+    std::cerr << "[ray crash ring] " << capacity << " bytes is less than one record, " << path << " not created\n";
+    return nullptr;
+  }
+  uint64_t slot_count = 1;
+  while (slot_count * 2 * kCrashRingSlotSize <= capacity) {
+    slot_count *= 2;
+  }
+  const size_t size = sizeof(CrashRingHeader) + slot_count * kCrashRingSlotSize;
+
+  const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    std::cerr << "[ray crash ring] failed creating " << path << ": " << std::strerror(errno) << '\n';
+    return nullptr;
+  }
+  // Allocate the blocks now: a store to a hole the file system cannot fill raises SIGBUS.
+  const int error = posix_fallocate(fd, 0, static_cast<off_t>(size));
+  void*     memory =
+      error == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  const int map_error = error != 0 ? error : errno;
+  close(fd);
+  if (memory == MAP_FAILED) {
+    std::cerr << "[ray crash ring] failed mapping " << path << ": " << std::strerror(map_error) << '\n';
+    return nullptr;
+  }
+
+  auto* header = new (memory) CrashRingHeader();
+  std::memcpy(header->magic, kCrashRingMagic, sizeof(kCrashRingMagic));
+  header->version    = kCrashRingVersion;
+  header->slot_size  = static_cast<uint32_t>(kCrashRingSlotSize);
+  header->slot_count = static_cast<uint32_t>(slot_count);
+  header->pid        = static_cast<uint32_t>(getpid());
+  return new CrashRingBuffer(path, header, slot_count);
+#endif
+}
+
+CrashRingBuffer::CrashRingBuffer(std::string path, CrashRingHeader* header, uint64_t slot_count)
+    : path_(std::move(path)), header_(header), slots_(reinterpret_cast<CrashRingSlot*>(header + 1)),
+      mask_(slot_count - 1) {
+  for (uint64_t i = 0; i < slot_count; ++i) {
+    new (&slots_[i]) CrashRingSlot();
+  }
+}
+
+void CrashRingBuffer::Append(int64_t time_ns, uint64_t thread_id, int level, const char* text, size_t size) {
+  const uint64_t index = header_->next.fetch_add(1, std::memory_order_relaxed);
+  CrashRingSlot& slot  = slots_[index & mask_];
+  // Invalidate the slot before overwriting it, so a crash half way leaves no
+  // record that mixes two.
+  slot.sequence.exchange(0, std::memory_order_acquire);
+  slot.time_ns   = time_ns;
+  slot.thread_id = thread_id;
+  slot.level     = static_cast<int8_t>(level);
+  slot.size      = static_cast<uint16_t>(std::min(size, sizeof(slot.text)));
+  std::memcpy(slot.text, text, slot.size);
+  slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+} // namespace ray
@@ -5,6 +5,7 @@
 #include "logging.h"
 
 #ifdef _WIN32
+#include <io.h>
 #include <process.h>
 #else
 // #include <execinfo.h>
@@ -14,26 +15,53 @@
 #ifndef _WIN32
 #include <unistd.h>
 #endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "ConfigFile.h"
+#include "deferred_log.h"
+#include "details/async_log_backend.h"
+#include "details/config_watcher.h"
+#include "details/crash_ring_buffer.h"
+#include "details/periodic_flusher.h"
+#include "details/rotation_worker.h"
+#include "details/token_bucket.h"
+#include "sinks/background_rotating_file_sink.h"
+#include "sinks/binary_file_sink.h"
+#include "sinks/flush_policy_sink.h"
+#include "sinks/rate_limit_sink.h"
 #include <algorithm>
 #include <cctype>
 #include <csignal>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <fmt/args.h>
 #include <fmt/chrono.h>
 #include <fmt/core.h>
+#include <filesystem>
+#include <fmt/format.h>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <spdlog/common.h>
+#include <spdlog/details/os.h>
 #include <spdlog/logger.h>
 // #include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/sinks/dist_sink.h>
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -45,24 +73,55 @@ namespace ray {
 
 #define EL_RAY_FATAL_CHECK_FAILED "RAY_FATAL_CHECK_FAILED"
 
-RayLogLevel RayLog::severity_threshold_ = RayLogLevel::INFO;
-std::string RayLog::app_name_;
-std::string RayLog::log_dir_;
-// Format pattern is 2020-08-21 17:00:00,000 I 100 1001 msg.
-// %L is loglevel, %P is process id, %t for thread id.
-std::string RayLog::log_format_pattern_                  = "[%Y-%m-%d %H:%M:%S,%e %L %P %t] %v";
-std::string RayLog::logger_name_                         = "ray_log_sink";
-uint64_t    RayLog::log_rotation_max_size_               = (1 << 23);
-int64_t     RayLog::log_rotation_file_num_               = 3;
-bool        RayLog::is_failure_signal_handler_installed_ = false;
-
-inline const char* ConstBasename(const char* filepath) {
-  const char* base = strrchr(filepath, '/');
-#ifdef OS_WINDOWS // Look for either path separator in Windows
-  if (base != nullptr)
-    base = strrchr(filepath, '\\');
-#endif
-  return (base != nullptr) ? (base + 1) : filepath;
+/// What logging threads read of the RayLog configuration. A published snapshot is
+/// immutable and is not freed before ShutDownRayLog, so readers load the pointer
+/// and use it without locking; UpdateState publishes a changed copy instead.
+struct RayLogState {
+  RayLogLevel severity_threshold = RayLogLevel::INFO;
+  // Format pattern is 2020-08-21 17:00:00,000 I 100 1001 msg.
+  // %L is loglevel, %P is process id, %t for thread id.
+  std::string log_format_pattern = "[%Y-%m-%d %H:%M:%S,%e %L %P %t] %v";
+  // Ray default logger name.
+  std::string logger_name = "ray_log_sink";
+  // Logger published by StartRayLog, read by every message without a registry
+  // lookup. Kept alive by the snapshot until ShutDownRayLog frees retired ones.
+  std::shared_ptr<spdlog::logger> logger;
+  /// Callback functions which will be triggered to expose fatal log.
+  std::vector<FatalLogCallback> fatal_log_callbacks;
+};
+
+static const RayLogState kInitialRayLogState{};
+
+/// Snapshots replaced by UpdateState. A thread may still read any of them, so
+/// they are only freed by ShutDownRayLog, when no thread may be logging.
+static std::mutex                                      state_update_mutex;
+static std::vector<std::unique_ptr<const RayLogState>> retired_states;
+
+std::atomic<const RayLogState*> RayLog::state_{&kInitialRayLogState};
+std::atomic<RayLogLevel>        RayLog::severity_threshold_{RayLogLevel::INFO};
+std::string                     RayLog::app_name_;
+std::string                     RayLog::log_dir_;
+std::string                     RayLog::log_level_file_;
+uint64_t                        RayLog::log_rotation_max_size_               = (1 << 23);
+int64_t                         RayLog::log_rotation_file_num_               = 3;
+bool                            RayLog::is_failure_signal_handler_installed_ = false;
+
+const RayLogState& RayLog::State() { return *state_.load(std::memory_order_acquire); }
+
+void RayLog::UpdateState(const std::function<void(RayLogState&)>& update) {
+  std::lock_guard<std::mutex> lock(state_update_mutex);
+  auto                        state = std::make_unique<RayLogState>(State());
+  update(*state);
+  severity_threshold_.store(state->severity_threshold, std::memory_order_relaxed);
+  const RayLogState* retired = state_.exchange(state.release(), std::memory_order_acq_rel);
+  if (retired != &kInitialRayLogState) {
+    retired_states.emplace_back(retired);
+  }
+}
+
+void RayLog::FreeRetiredStates() {
+  std::lock_guard<std::mutex> lock(state_update_mutex);
+  retired_states.clear();
 }
 
 /// A logger that prints logs to stderr.
@@ -71,7 +130,7 @@ inline const char* ConstBasename(const char* filepath) {
 /// variable so core worker process can invoke `RAY_LOG` in its whole lifecyle.
 class DefaultStdErrLogger final {
 public:
-  std::shared_ptr<spdlog::logger> GetDefaultLogger() { return default_stderr_logger_; }
+  const std::shared_ptr<spdlog::logger>& GetDefaultLogger() { return default_stderr_logger_; }
 
   static DefaultStdErrLogger& Instance() {
     static DefaultStdErrLogger instance;
@@ -91,28 +150,109 @@ private:
   std::shared_ptr<spdlog::logger> default_stderr_logger_;
 };
 
+/// Writer thread of the published logger, nullptr when RayLog is synchronous.
+static std::atomic<AsyncLogBackend*> async_log_backend{nullptr};
+
+/// Memory-mapped tail of the log for postmortems, nullptr when there is none.
+static std::atomic<CrashRingBuffer*> crash_ring{nullptr};
+
+/// Size of the crash ring file unless RAY_BACKEND_LOG_CRASH_RING_BYTES says otherwise.
+constexpr size_t kDefaultCrashRingBytes = 1 << 20;
+
+/// Rings opened by this process, by path. A ring is never unmapped, so a later
+/// StartRayLog for the same path reuses it, whatever its capacity, instead of
+/// truncating a file that is still mapped.
+static std::unordered_map<std::string, CrashRingBuffer*> crash_rings;
+
+static CrashRingBuffer* OpenCrashRing(const std::string& path, size_t capacity) {
+  auto it = crash_rings.find(path);
+  if (it != crash_rings.end()) {
+    return it->second;
+  }
+  CrashRingBuffer* ring = CrashRingBuffer::Open(path, capacity);
+  if (ring != nullptr) {
+    crash_rings.emplace(path, ring);
+  }
+  return ring;
+}
+
+static void AppendToCrashRing(spdlog::level::level_enum level, spdlog::string_view_t text) {
+  CrashRingBuffer* ring = crash_ring.load(std::memory_order_acquire);
+  if (ring != nullptr) {
+    const auto now = spdlog::log_clock::now().time_since_epoch();
+    ring->Append(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), spdlog::details::os::thread_id(),
+                 level, text.data(), text.size());
+  }
+}
+
+/// Write one finished RAY_LOG message to the published logger. With the
+/// asynchronous backend the record is queued, except FATAL which drains the
+/// queue and is written and flushed before returning. The crash ring gets the
+/// record first, so it holds records still waiting in the queue.
+static void DispatchLogMessage(spdlog::level::level_enum level, spdlog::string_view_t text,
+                               const spdlog::source_loc& source) {
+  AppendToCrashRing(level, text);
+  AsyncLogBackend* backend = async_log_backend.load(std::memory_order_acquire);
+  if (backend != nullptr) {
+    if (level != spdlog::level::critical) {
+      backend->Post(level, text, source);
+      return;
+    }
+    backend->Drain();
+  }
+  spdlog::logger* logger = RayLog::GetLogger();
+  if (logger == nullptr) {
+    logger = DefaultStdErrLogger::Instance().GetDefaultLogger().get();
+  }
+  logger->log(source, level, text);
+  if (level == spdlog::level::critical) {
+    logger->flush();
+  }
+}
+
+/// Replace the asynchronous backend. The previous one is stopped, which drains
+/// its queue, but stays allocated for threads that loaded it just before the swap.
+static void PublishAsyncBackend(std::unique_ptr<AsyncLogBackend> backend) {
+  static std::mutex                                    backends_mutex;
+  static std::vector<std::unique_ptr<AsyncLogBackend>> backends;
+  std::lock_guard<std::mutex>                          lock(backends_mutex);
+  AsyncLogBackend* previous = async_log_backend.exchange(backend.get(), std::memory_order_acq_rel);
+  if (backend) {
+    if (backends.empty()) {
+      // Records still queued when main() returns are written before exit.
+      std::atexit([] { PublishAsyncBackend(nullptr); });
+    }
+    backends.emplace_back(std::move(backend));
+  }
+  if (previous != nullptr) {
+    previous->Stop();
+  }
+}
+
 class SpdLogMessage final {
 public:
-  explicit SpdLogMessage(const char* file, int line, int loglevel, std::shared_ptr<std::ostringstream> expose_osstream)
-      : loglevel_(loglevel), expose_osstream_(std::move(expose_osstream)) {
-    stream() << ConstBasename(file) << ":" << line << ": ";
+  explicit SpdLogMessage(const RayLogSite& site, int loglevel, std::shared_ptr<std::ostringstream> expose_osstream)
+      : loglevel_(loglevel), source_(site.Basename(), site.Line(), nullptr),
+        expose_osstream_(std::move(expose_osstream)) {
+    stream() << site.Basename() << site.LineText();
   }
 
-  inline void Flush() {
-    auto logger = spdlog::get(RayLog::GetLoggerName());
-    if (!logger) {
-      logger = DefaultStdErrLogger::Instance().GetDefaultLogger();
-    }
+  static SpdLogMessage* Acquire(const RayLogSite& site, int loglevel,
+                                std::shared_ptr<std::ostringstream> expose_osstream) {
+    return new SpdLogMessage(site, loglevel, std::move(expose_osstream));
+  }
+
+  static void Release(SpdLogMessage* message) { delete message; }
 
+  inline void Flush() {
     if (loglevel_ == static_cast<int>(spdlog::level::critical)) {
       stream() << "\n*** StackTrace Information ***\n";
     }
     if (expose_osstream_) {
       *expose_osstream_ << "\n*** StackTrace Information ***\n";
     }
-    // NOTE(lingxuan.zlx): See more fmt by visiting https://github.com/fmtlib/fmt.
-    logger->log(static_cast<spdlog::level::level_enum>(loglevel_), /*fmt*/ "{}", str_.str());
-    logger->flush();
+    const std::string text = str_.str();
+    DispatchLogMessage(static_cast<spdlog::level::level_enum>(loglevel_), text, source_);
   }
 
   SpdLogMessage(SpdLogMessage&&)                  = delete;
@@ -126,10 +266,175 @@ public:
 private:
   std::ostringstream                  str_;
   int                                 loglevel_;
+  spdlog::source_loc                  source_;
   std::shared_ptr<std::ostringstream> expose_osstream_;
 };
 
+/// A std::streambuf whose put area is the storage of a fmt::memory_buffer, so
+/// operator<< formats straight into memory that is reused from message to message.
+class MemoryBufferStreamBuf final : public std::streambuf {
+public:
+  MemoryBufferStreamBuf() { Reset(); }
+
+  /// Drop the current content but keep the capacity.
+  void Reset() {
+    buf_.resize(buf_.capacity());
+    setp(buf_.data(), buf_.data() + buf_.size());
+  }
+
+  /// The text written since the last Reset(). Valid until the next write or Reset().
+  spdlog::string_view_t View() const {
+    return {pbase(), static_cast<size_t>(pptr() - pbase())};
+  }
+
+protected:
+  int_type overflow(int_type ch) override {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+      return traits_type::not_eof(ch);
+    }
+    Grow(1);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    if (epptr() - pptr() < n) {
+      Grow(static_cast<size_t>(n));
+    }
+    std::memcpy(pptr(), s, static_cast<size_t>(n));
+    pbump(static_cast<int>(n));
+    return n;
+  }
+
+private:
+  void Grow(size_t extra) {
+    const auto used = static_cast<size_t>(pptr() - pbase());
+    buf_.resize(std::max(used + extra, buf_.size() * 2));
+    buf_.resize(buf_.capacity());
+    setp(buf_.data(), buf_.data() + buf_.size());
+    pbump(static_cast<int>(used));
+  }
+
+  fmt::memory_buffer buf_;
+};
+
+/// Logging provider whose stream and formatting buffer live in a per-thread arena.
+/// Instances are created once per thread (and per nesting depth) and then reused,
+/// so a steady-state RAY_LOG statement performs no allocation and hands the
+/// formatted text to spdlog as a view, without copying it out of the stream.
+class ArenaLogMessage final {
+public:
+  ArenaLogMessage() : stream_(&streambuf_), default_flags_(stream_.flags()) {}
+
+  static ArenaLogMessage* Acquire(const RayLogSite& site, int loglevel,
+                                  std::shared_ptr<std::ostringstream> expose_osstream) {
+    ArenaLogMessage* message = Arena::Borrow();
+    message->Reset(site, loglevel, std::move(expose_osstream));
+    return message;
+  }
+
+  static void Release(ArenaLogMessage* message) {
+    message->Flush();
+    message->expose_osstream_.reset();
+    Arena::Return(message);
+  }
+
+  inline void Flush() {
+    if (loglevel_ == static_cast<int>(spdlog::level::critical)) {
+      stream() << "\n*** StackTrace Information ***\n";
+    }
+    if (expose_osstream_) {
+      *expose_osstream_ << "\n*** StackTrace Information ***\n";
+    }
+    DispatchLogMessage(static_cast<spdlog::level::level_enum>(loglevel_), streambuf_.View(), source_);
+  }
+
+  ArenaLogMessage(ArenaLogMessage&&)                  = delete;
+  ArenaLogMessage(const ArenaLogMessage&)             = delete;
+  ArenaLogMessage& operator=(const ArenaLogMessage&)  = delete;
+  ArenaLogMessage& operator=(ArenaLogMessage&& other) = delete;
+  ~ArenaLogMessage()                                  = default;
+  inline std::ostream& stream() { return stream_; }
+
+private:
+  /// Per-thread stack of messages. A RAY_LOG statement borrows the top slot for its
+  /// lifetime; a RAY_LOG evaluated while another one is being built (e.g. inside an
+  /// operator<<) takes the next slot, so slots are always returned in LIFO order.
+  class Arena final {
+  public:
+    static ArenaLogMessage* Borrow() {
+      Arena* arena = Current();
+      if (arena == nullptr) {
+        // Logging from a thread_local destructor that runs after the arena is gone.
+        auto* message  = new ArenaLogMessage();
+        message->heap_ = true;
+        return message;
+      }
+      if (arena->depth_ == arena->slots_.size()) {
+        arena->slots_.emplace_back(std::make_unique<ArenaLogMessage>());
+      }
+      return arena->slots_[arena->depth_++].get();
+    }
+
+    static void Return(ArenaLogMessage* message) {
+      if (message->heap_) {
+        delete message;
+        return;
+      }
+      Current()->depth_--;
+    }
+
+    Arena()                        = default;
+    Arena(Arena&&)                 = delete;
+    Arena(const Arena&)            = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena& operator=(Arena&&)      = delete;
+    ~Arena() { destroyed_ = true; }
+
+  private:
+    static Arena* Current() {
+      if (destroyed_) {
+        return nullptr;
+      }
+      thread_local Arena arena;
+      return &arena;
+    }
+
+    std::vector<std::unique_ptr<ArenaLogMessage>> slots_;
+    size_t                                        depth_{0};
+    static thread_local bool                      destroyed_;
+  };
+
+  void Reset(const RayLogSite& site, int loglevel, std::shared_ptr<std::ostringstream> expose_osstream) {
+    loglevel_        = loglevel;
+    source_          = spdlog::source_loc(site.Basename(), site.Line(), nullptr);
+    expose_osstream_ = std::move(expose_osstream);
+    streambuf_.Reset();
+    stream_.clear();
+    stream_.flags(default_flags_);
+    stream_.width(0);
+    stream_.precision(6);
+    stream_.fill(' ');
+    stream_ << site.Basename() << site.LineText();
+  }
+
+  MemoryBufferStreamBuf               streambuf_;
+  std::ostream                        stream_;
+  std::ios_base::fmtflags             default_flags_;
+  int                                 loglevel_{0};
+  spdlog::source_loc                  source_;
+  bool                                heap_{false};
+  std::shared_ptr<std::ostringstream> expose_osstream_;
+};
+
+thread_local bool ArenaLogMessage::Arena::destroyed_ = false;
+
+#ifdef RAY_LOG_ARENA_PROVIDER
+using LoggingProvider = ray::ArenaLogMessage;
+#else
 using LoggingProvider = ray::SpdLogMessage;
+#endif
 
 // Spdlog's severity map.
 static int GetMappedSeverity(RayLogLevel severity) {
@@ -153,35 +458,178 @@ static int GetMappedSeverity(RayLogLevel severity) {
   }
 }
 
-std::vector<FatalLogCallback> RayLog::fatal_log_callbacks_;
+/// Parse a level name as accepted by RAY_BACKEND_LOG_LEVEL, case insensitively.
+///
+/// \return False if `name` is not a level name; `level` is left unchanged.
+static bool ParseRayLogLevel(std::string name, RayLogLevel& level) {
+  std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+  if (name == "trace") {
+    level = RayLogLevel::TRACE;
+  } else if (name == "debug") {
+    level = RayLogLevel::DEBUG;
+  } else if (name == "info") {
+    level = RayLogLevel::INFO;
+  } else if (name == "warning") {
+    level = RayLogLevel::WARNING;
+  } else if (name == "error") {
+    level = RayLogLevel::ERROR;
+  } else if (name == "fatal") {
+    level = RayLogLevel::FATAL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/// Wrap `sink` so it is flushed according to `flush_policy` instead of after every record.
+static spdlog::sink_ptr WithFlushPolicy(spdlog::sink_ptr sink, const RayLogFlushPolicy& flush_policy) {
+  const RayLogLevel flush_level = std::min(flush_policy.level, RayLogLevel::ERROR);
+  return std::make_shared<vtpl::sinks::flush_policy_sink_mt>(
+      std::move(sink), static_cast<spdlog::level::level_enum>(GetMappedSeverity(flush_level)), flush_policy.bytes,
+      flush_policy.interval);
+}
+
+/// Token bucket shared by every rate limited logger, see RayLogRateLimit::global_rate.
+static const std::shared_ptr<vtpl::details::token_bucket>& GlobalLogBucket() {
+  static const auto bucket = std::make_shared<vtpl::details::token_bucket>();
+  return bucket;
+}
+
+/// Records held back by every rate limited logger.
+static const std::shared_ptr<vtpl::sinks::rate_limit_counters>& RateLimitCounters() {
+  static const auto counters = std::make_shared<vtpl::sinks::rate_limit_counters>();
+  return counters;
+}
+
+/// Put the sinks of a logger behind one rate_limit_sink, so they share its limits,
+/// unless no limit applies.
+static std::vector<spdlog::sink_ptr> WithRateLimit(std::vector<spdlog::sink_ptr> sinks,
+                                                   const RayLogRateLimit&        rate_limit) {
+  if (rate_limit.rate <= 0 && rate_limit.duplicate_window.count() <= 0 && !GlobalLogBucket()->enabled()) {
+    return sinks;
+  }
+  spdlog::sink_ptr inner =
+      sinks.size() == 1 ? sinks.front() : std::make_shared<spdlog::sinks::dist_sink_mt>(std::move(sinks));
+  return {std::make_shared<vtpl::sinks::rate_limit_sink_mt>(std::move(inner), rate_limit.rate, rate_limit.burst,
+                                                            rate_limit.duplicate_window, GlobalLogBucket(),
+                                                            RateLimitCounters())};
+}
+
+/// The compression of rotated RayLog files, from RAY_ROTATION_COMPRESSION.
+static vtpl::rotation_compression RotationCompression() {
+  const char* compression_value = getenv("RAY_ROTATION_COMPRESSION");
+  if (compression_value == nullptr) {
+    return vtpl::rotation_compression::none;
+  }
+  std::string data = compression_value;
+  std::transform(data.begin(), data.end(), data.begin(), ::tolower);
+  if (data == "gzip" || data == "gz") {
+    return vtpl::rotation_compression::gzip;
+  }
+  if (data != "none" && !data.empty()) {
+    RAY_LOG(WARNING) << "Unrecognized setting of RAY_ROTATION_COMPRESSION=" << compression_value;
+  }
+  return vtpl::rotation_compression::none;
+}
+
+/// Rotating sink for RayLog files. Unless RAY_ROTATION_IN_BACKGROUND is false,
+/// the rename cascade of a rotation runs on the rotation worker thread instead of
+/// stalling every logging thread, and RAY_ROTATION_COMPRESSION=gzip has the
+/// worker compress the rotated files.
+template <typename Mutex>
+static spdlog::sink_ptr MakeRotatingFileSink(const std::string& filename, size_t max_size, size_t max_files) {
+  const char* value = getenv("RAY_ROTATION_IN_BACKGROUND");
+  std::string data  = value != nullptr ? value : "";
+  std::transform(data.begin(), data.end(), data.begin(), ::tolower);
+  if (data == "0" || data == "false" || data == "off") {
+    return std::make_shared<spdlog::sinks::rotating_file_sink<Mutex>>(filename, max_size, max_files);
+  }
+  return std::make_shared<vtpl::sinks::background_rotating_file_sink<Mutex>>(
+      filename, max_size, max_files, false, spdlog::file_event_handlers(), RotationCompression());
+}
+
+/// Whether RAY_BACKEND_LOG_BINARY asks for the binary log format.
+static bool UseBinaryLogFormat() {
+  const char* value = getenv("RAY_BACKEND_LOG_BINARY");
+  std::string data  = value != nullptr ? value : "";
+  std::transform(data.begin(), data.end(), data.begin(), ::tolower);
+  return data == "1" || data == "true" || data == "on";
+}
 
 void RayLog::StartRayLog(const std::string& app_name, RayLogLevel severity_threshold, const std::string& log_dir,
-                         bool use_pid) {
+                         bool use_pid, RayLogAsyncOptions async_options, RayLogFlushPolicy flush_policy,
+                         RayLogRateLimit rate_limit) {
   const char* var_value = getenv("RAY_BACKEND_LOG_LEVEL");
   if (var_value != nullptr) {
-    std::string data = var_value;
-    std::transform(data.begin(), data.end(), data.begin(), ::tolower);
-    if (data == "trace") {
-      severity_threshold = RayLogLevel::TRACE;
-    } else if (data == "debug") {
-      severity_threshold = RayLogLevel::DEBUG;
-    } else if (data == "info") {
-      severity_threshold = RayLogLevel::INFO;
-    } else if (data == "warning") {
-      severity_threshold = RayLogLevel::WARNING;
-    } else if (data == "error") {
-      severity_threshold = RayLogLevel::ERROR;
-    } else if (data == "fatal") {
-      severity_threshold = RayLogLevel::FATAL;
-    } else {
+    if (!ParseRayLogLevel(var_value, severity_threshold)) {
       RAY_LOG(WARNING) << "Unrecognized setting of RAY_BACKEND_LOG_LEVEL=" << var_value;
     }
     RAY_LOG(INFO) << "Set ray log level from environment variable RAY_BACKEND_LOG_LEVEL"
                   << " to " << static_cast<int>(severity_threshold);
   }
-  severity_threshold_ = severity_threshold;
-  app_name_           = app_name;
-  log_dir_            = log_dir;
+  const char* flush_level_value = getenv("RAY_BACKEND_LOG_FLUSH_LEVEL");
+  if (flush_level_value != nullptr && !ParseRayLogLevel(flush_level_value, flush_policy.level)) {
+    RAY_LOG(WARNING) << "Unrecognized setting of RAY_BACKEND_LOG_FLUSH_LEVEL=" << flush_level_value;
+  }
+  const char* flush_bytes_value = getenv("RAY_BACKEND_LOG_FLUSH_BYTES");
+  if (flush_bytes_value != nullptr) {
+    flush_policy.bytes = static_cast<size_t>(std::max(0L, std::atol(flush_bytes_value)));
+  }
+  const char* flush_interval_value = getenv("RAY_BACKEND_LOG_FLUSH_INTERVAL_MS");
+  if (flush_interval_value != nullptr) {
+    flush_policy.interval = std::chrono::milliseconds(std::max(0L, std::atol(flush_interval_value)));
+  }
+  const char* async_value = getenv("RAY_BACKEND_LOG_ASYNC");
+  if (async_value != nullptr) {
+    std::string data = async_value;
+    std::transform(data.begin(), data.end(), data.begin(), ::tolower);
+    async_options.enabled = (data == "1" || data == "true" || data == "on");
+  }
+  const char* queue_size_value = getenv("RAY_BACKEND_LOG_QUEUE_SIZE");
+  if (queue_size_value != nullptr) {
+    auto queue_size = std::atol(queue_size_value);
+    if (queue_size > 0) {
+      async_options.queue_size = static_cast<size_t>(queue_size);
+    }
+  }
+  const char* overflow_value = getenv("RAY_BACKEND_LOG_OVERFLOW_POLICY");
+  if (overflow_value != nullptr) {
+    std::string data = overflow_value;
+    std::transform(data.begin(), data.end(), data.begin(), ::tolower);
+    if (data == "block") {
+      async_options.overflow_policy = RayLogOverflowPolicy::BLOCK;
+    } else if (data == "drop_newest") {
+      async_options.overflow_policy = RayLogOverflowPolicy::DROP_NEWEST;
+    } else if (data == "drop_oldest") {
+      async_options.overflow_policy = RayLogOverflowPolicy::DROP_OLDEST;
+    } else {
+      RAY_LOG(WARNING) << "Unrecognized setting of RAY_BACKEND_LOG_OVERFLOW_POLICY=" << overflow_value;
+    }
+  }
+  const char* rate_value = getenv("RAY_BACKEND_LOG_RATE_LIMIT");
+  if (rate_value != nullptr) {
+    rate_limit.rate = std::atof(rate_value);
+  }
+  const char* burst_value = getenv("RAY_BACKEND_LOG_RATE_BURST");
+  if (burst_value != nullptr) {
+    auto burst = std::atol(burst_value);
+    if (burst > 0) {
+      rate_limit.burst = static_cast<size_t>(burst);
+    }
+  }
+  const char* global_rate_value = getenv("RAY_BACKEND_LOG_GLOBAL_RATE_LIMIT");
+  if (global_rate_value != nullptr) {
+    rate_limit.global_rate = std::atof(global_rate_value);
+  }
+  const char* duplicate_window_value = getenv("RAY_BACKEND_LOG_DUPLICATE_WINDOW_MS");
+  if (duplicate_window_value != nullptr) {
+    rate_limit.duplicate_window = std::chrono::milliseconds(std::atol(duplicate_window_value));
+  }
+  GlobalLogBucket()->set_rate(rate_limit.global_rate, static_cast<double>(rate_limit.global_burst));
+
+  UpdateState([severity_threshold](RayLogState& state) { state.severity_threshold = severity_threshold; });
+  app_name_ = app_name;
+  log_dir_  = log_dir;
 
   if (!log_dir_.empty()) {
     // Enable log file if log_dir_ is not empty.
@@ -210,8 +658,8 @@ void RayLog::StartRayLog(const std::string& app_name, RayLogLevel severity_thres
         log_rotation_file_num_ = file_num;
       }
     }
-    spdlog::set_pattern(log_format_pattern_);
-    spdlog::set_level(static_cast<spdlog::level::level_enum>(severity_threshold_));
+    spdlog::set_pattern(GetLogFormatPattern());
+    spdlog::set_level(static_cast<spdlog::level::level_enum>(GetMappedSeverity(severity_threshold)));
     // Sink all log stuff to default file logger we defined here. We may need
     // multiple sinks for different files or loglevel.
     auto file_logger = spdlog::get(RayLog::GetLoggerName());
@@ -220,27 +668,203 @@ void RayLog::StartRayLog(const std::string& app_name, RayLogLevel severity_thres
       // logger.
       spdlog::drop(RayLog::GetLoggerName());
     }
-    const std::string log_file = dir_ends_with_slash + app_name_without_path + "_" + std::to_string(pid) + ".log";
+    const bool        binary   = UseBinaryLogFormat();
+    const std::string log_file = dir_ends_with_slash + app_name_without_path + "_" + std::to_string(pid) +
+                                 (binary ? ".blog" : ".log");
     std::cout << "\n\nLog at: " << log_file << '\n';
-    file_logger =
-        spdlog::rotating_logger_mt(RayLog::GetLoggerName(), log_file, log_rotation_max_size_, log_rotation_file_num_);
+    auto file_sink = binary ? std::make_shared<vtpl::sinks::binary_file_sink_mt>(
+                                  log_file, log_rotation_max_size_, log_rotation_file_num_, RotationCompression())
+                            : MakeRotatingFileSink<std::mutex>(log_file, log_rotation_max_size_, log_rotation_file_num_);
+    auto sinks     = WithRateLimit({WithFlushPolicy(file_sink, flush_policy)}, rate_limit);
+    file_logger    = std::make_shared<spdlog::logger>(RayLog::GetLoggerName(), sinks.begin(), sinks.end());
+    spdlog::initialize_logger(file_logger);
     spdlog::set_default_logger(file_logger);
+    PublishLogger(file_logger);
+    PublishAsyncBackend(async_options.enabled ? std::make_unique<AsyncLogBackend>(file_logger, async_options.queue_size,
+                                                                                 async_options.overflow_policy)
+                                              : nullptr);
+
+    const char* crash_ring_value = getenv("RAY_BACKEND_LOG_CRASH_RING_BYTES");
+    const long  crash_ring_bytes =
+        crash_ring_value != nullptr ? std::atol(crash_ring_value) : static_cast<long>(kDefaultCrashRingBytes);
+    const std::string crash_file = dir_ends_with_slash + app_name_without_path + "_" + std::to_string(pid) + ".crash";
+    crash_ring.store(crash_ring_bytes > 0 ? OpenCrashRing(crash_file, static_cast<size_t>(crash_ring_bytes)) : nullptr,
+                     std::memory_order_release);
   } else {
+    // The threshold is applied by the logger alone, so SetLogLevel can change it.
     auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-    console_sink->set_pattern(log_format_pattern_);
-    auto level = static_cast<spdlog::level::level_enum>(severity_threshold_);
-    console_sink->set_level(level);
+    console_sink->set_pattern(GetLogFormatPattern());
+    auto level = static_cast<spdlog::level::level_enum>(GetMappedSeverity(severity_threshold));
 
     auto err_sink = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
-    err_sink->set_pattern(log_format_pattern_);
+    err_sink->set_pattern(GetLogFormatPattern());
     err_sink->set_level(spdlog::level::err);
 
-    auto logger =
-        std::make_shared<spdlog::logger>(RayLog::GetLoggerName(), spdlog::sinks_init_list({console_sink, err_sink}));
+    auto sinks =
+        WithRateLimit({WithFlushPolicy(console_sink, flush_policy), WithFlushPolicy(err_sink, flush_policy)}, rate_limit);
+    auto logger = std::make_shared<spdlog::logger>(RayLog::GetLoggerName(), sinks.begin(), sinks.end());
 
     logger->set_level(level);
     spdlog::set_default_logger(logger);
+    PublishLogger(logger);
+    PublishAsyncBackend(async_options.enabled ? std::make_unique<AsyncLogBackend>(logger, async_options.queue_size,
+                                                                                 async_options.overflow_policy)
+                                              : nullptr);
+    crash_ring.store(nullptr, std::memory_order_release);
+  }
+
+  const char* level_spec = getenv("RAY_BACKEND_LOG_LEVEL_SPEC");
+  if (level_spec != nullptr) {
+    SetLogLevelSpec(level_spec);
+  } else {
+    RayLogSite::ResolveAll();
+  }
+  const char* level_file = getenv("RAY_BACKEND_LOG_LEVEL_FILE");
+  if (level_file != nullptr && level_file[0] != '\0') {
+    WatchLogLevelFile(level_file);
+  }
+}
+
+void RayLog::PublishLogger(std::shared_ptr<spdlog::logger> logger) {
+  // The previous logger stays alive in its retired snapshot, so a thread that loaded
+  // the handle just before the swap can still finish writing through it.
+  UpdateState([&logger](RayLogState& state) { state.logger = std::move(logger); });
+}
+
+/// Signals whose action InstallFailureSignalHandler replaces.
+static const std::vector<int> installed_signals({SIGSEGV, SIGILL, SIGFPE, SIGABRT, SIGTERM});
+
+/// Append `text` to [out, end) without allocating, for the signal handler.
+static char* AppendSignalSafe(char* out, const char* end, const char* text) {
+  while (*text != '\0' && out < end) {
+    *out++ = *text++;
+  }
+  return out;
+}
+
+static char* AppendSignalSafe(char* out, const char* end, uint64_t value, unsigned base) {
+  char digits[64] = {};
+  int  count      = 0;
+  do {
+    digits[count++] = "0123456789abcdef"[value % base];
+    value /= base;
+  } while (value != 0);
+  while (count > 0 && out < end) {
+    *out++ = digits[--count];
+  }
+  return out;
+}
+
+static const char* SignalName(int signal_number) {
+  switch (signal_number) {
+  case SIGSEGV:
+    return "SIGSEGV";
+  case SIGILL:
+    return "SIGILL";
+  case SIGFPE:
+    return "SIGFPE";
+  case SIGABRT:
+    return "SIGABRT";
+  case SIGTERM:
+    return "SIGTERM";
+  default:
+    return "signal";
+  }
+}
+
+/// Report a fatal signal to the crash ring and stderr, then let the default
+/// action terminate the process. Only async-signal-safe calls are made: the
+/// spdlog loggers may be locked or broken by the very fault being reported.
+/// `address` is the faulting address, if known.
+static void HandleFailureSignal(int signal_number, const uintptr_t* address) {
+  char        message[160] = {};
+  const char* end          = message + sizeof(message) - 1;
+  char*       out          = message;
+  out                      = AppendSignalSafe(out, end, "*** ");
+  out                      = AppendSignalSafe(out, end, SignalName(signal_number));
+  out                      = AppendSignalSafe(out, end, " received");
+  if (address != nullptr) {
+    out = AppendSignalSafe(out, end, " at address 0x");
+    out = AppendSignalSafe(out, end, *address, 16);
+  }
+#ifdef _WIN32
+  const uint64_t pid       = static_cast<uint64_t>(_getpid());
+  const uint64_t thread_id = 0;
+#else
+  const uint64_t pid = static_cast<uint64_t>(getpid());
+#ifdef __linux__
+  const uint64_t thread_id = static_cast<uint64_t>(syscall(SYS_gettid));
+#else
+  const uint64_t thread_id = 0;
+#endif
+#endif
+  out = AppendSignalSafe(out, end, ", pid ");
+  out = AppendSignalSafe(out, end, pid, 10);
+  out = AppendSignalSafe(out, end, ", thread ");
+  out = AppendSignalSafe(out, end, thread_id, 10);
+  out = AppendSignalSafe(out, end, " ***");
+
+  CrashRingBuffer* ring = crash_ring.load(std::memory_order_acquire);
+  if (ring != nullptr) {
+    timespec now{};
+#ifdef _WIN32
+    timespec_get(&now, TIME_UTC);
+#else
+    clock_gettime(CLOCK_REALTIME, &now);
+#endif
+    ring->Append(static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec, thread_id, spdlog::level::critical,
+                 message, static_cast<size_t>(out - message));
   }
+  *out++ = '\n';
+#ifdef _WIN32
+  (void)_write(2, message, static_cast<unsigned>(out - message));
+#else
+  (void)write(STDERR_FILENO, message, static_cast<size_t>(out - message));
+#endif
+  // The default action was restored when the handler was entered.
+  raise(signal_number);
+}
+
+#ifdef _WIN32
+static void FailureSignalHandler(int signal_number) {
+  signal(signal_number, SIG_DFL);
+  HandleFailureSignal(signal_number, nullptr);
+}
+#else
+static void FailureSignalHandler(int signal_number, siginfo_t* info, void* /*context*/) {
+  const bool      fault   = signal_number == SIGSEGV || signal_number == SIGILL || signal_number == SIGFPE;
+  const uintptr_t address = info != nullptr ? reinterpret_cast<uintptr_t>(info->si_addr) : 0;
+  HandleFailureSignal(signal_number, fault && info != nullptr ? &address : nullptr);
+}
+#endif
+
+void RayLog::InstallFailureSignalHandler() {
+  if (is_failure_signal_handler_installed_) {
+    return;
+  }
+  RAY_LOG(DEBUG) << "Install signal handlers.";
+#ifdef _WIN32 // Do NOT use WIN32 (without the underscore); we want _WIN32 here
+  for (int signal_num : installed_signals) {
+    RAY_CHECK(signal(signal_num, FailureSignalHandler) != SIG_ERR);
+  }
+#else
+  // Run the handler on its own stack, so a stack overflow of this thread is reported too.
+  static char alternate_stack[64 * 1024];
+  stack_t     stack{};
+  stack.ss_sp   = alternate_stack;
+  stack.ss_size = sizeof(alternate_stack);
+  (void)sigaltstack(&stack, nullptr);
+
+  struct sigaction sig_action {};
+  memset(&sig_action, 0, sizeof(sig_action));
+  sigemptyset(&sig_action.sa_mask);
+  sig_action.sa_sigaction = FailureSignalHandler;
+  sig_action.sa_flags     = SA_SIGINFO | SA_RESETHAND | SA_ONSTACK;
+  for (const int signal_num : installed_signals) {
+    RAY_CHECK(sigaction(signal_num, &sig_action, nullptr) == 0);
+  }
+#endif
+  is_failure_signal_handler_installed_ = true;
 }
 
 void RayLog::UninstallSignalAction() {
@@ -248,7 +872,6 @@ void RayLog::UninstallSignalAction() {
     return;
   }
   RAY_LOG(DEBUG) << "Uninstall signal handlers.";
-  const std::vector<int> installed_signals({SIGSEGV, SIGILL, SIGFPE, SIGABRT, SIGTERM});
 #ifdef _WIN32 // Do NOT use WIN32 (without the underscore); we want _WIN32 here
   for (int signal_num : installed_signals) {
     RAY_CHECK(signal(signal_num, SIG_DFL) != SIG_ERR);
@@ -267,9 +890,21 @@ void RayLog::UninstallSignalAction() {
 
 void RayLog::ShutDownRayLog() {
   UninstallSignalAction();
+  crash_ring.store(nullptr, std::memory_order_release);
+  if (!log_level_file_.empty()) {
+    ConfigWatcher::Instance().Unwatch(log_level_file_);
+    log_level_file_.clear();
+  }
+  PublishAsyncBackend(nullptr);
   if (spdlog::default_logger()) {
     spdlog::default_logger()->flush();
   }
+  // Let a pending rotation finish renaming files.
+  vtpl::details::rotation_worker::instance().wait_idle();
+  // RAY_LOG falls back to the default stderr logger from here on.
+  PublishLogger(nullptr);
+  // Closes the files of the loggers published since the last shutdown.
+  FreeRetiredStates();
   // NOTE(lingxuan.zlx) All loggers will be closed in shutdown but we don't need drop
   // console logger out because of some console logging might be used after shutdown ray
   // log. spdlog::shutdown();
@@ -286,6 +921,10 @@ void WriteFailureMessage(const char* data) {
   // If logger writes logs to files, logs are fully-buffered, which is different from
   // stdout (line-buffered) and stderr (unbuffered). So always flush here in case logs are
   // lost when logger writes logs to files.
+  AsyncLogBackend* backend = async_log_backend.load(std::memory_order_acquire);
+  if (backend != nullptr) {
+    backend->Drain();
+  }
   if (spdlog::default_logger()) {
     spdlog::default_logger()->flush();
   }
@@ -293,25 +932,347 @@ void WriteFailureMessage(const char* data) {
 
 bool RayLog::IsFailureSignalHandlerEnabled() { return is_failure_signal_handler_installed_; }
 
-bool RayLog::IsLevelEnabled(RayLogLevel log_level) { return log_level >= severity_threshold_; }
+void RayLog::SetLogLevel(RayLogLevel log_level) {
+  UpdateState([log_level](RayLogState& state) { state.severity_threshold = log_level; });
+  RayLogSite::ResolveAll();
+}
+
+/// A rule of the level spec: sites matching `pattern` use `level` as threshold.
+struct LogLevelRule {
+  std::string pattern;
+  RayLogLevel level;
+};
+
+/// Registered RAY_LOG sites, and the level spec they are resolved against.
+static std::mutex                log_sites_mutex;
+static std::vector<RayLogSite*>  log_sites;
+static std::vector<LogLevelRule> log_level_rules;
+
+/// Match `text` against a glob where * matches any characters and ? any one.
+static bool GlobMatch(const char* pattern, const char* text) {
+  const char* star   = nullptr;
+  const char* resume = nullptr;
+  while (*text != '\0') {
+    if (*pattern == '*') {
+      star   = pattern++;
+      resume = text;
+    } else if (*pattern == '?' || *pattern == *text) {
+      ++pattern;
+      ++text;
+    } else if (star != nullptr) {
+      // Let the last * swallow one more character.
+      pattern = star + 1;
+      text    = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (*pattern == '*') {
+    ++pattern;
+  }
+  return *pattern == '\0';
+}
+
+bool RayLogSite::Register() {
+  std::lock_guard<std::mutex> lock(log_sites_mutex);
+  if (state_.load(std::memory_order_relaxed) < 0) {
+    log_sites.push_back(this);
+    id_ = static_cast<uint32_t>(log_sites.size());
+    Resolve();
+  }
+  return state_.load(std::memory_order_relaxed) != 0;
+}
+
+void RayLogSite::Resolve() {
+  RayLogLevel threshold = RayLog::severity_threshold_.load(std::memory_order_relaxed);
+  for (const auto& rule : log_level_rules) {
+    const char* pattern = rule.pattern.c_str();
+    if ((module_[0] != '\0' && GlobMatch(pattern, module_)) || GlobMatch(pattern, file_) ||
+        GlobMatch(pattern, basename_)) {
+      threshold = rule.level;
+    }
+  }
+  const bool enabled = level_ == RayLogLevel::FATAL || level_ >= threshold;
+  state_.store(enabled ? 1 : 0, std::memory_order_relaxed);
+}
+
+void RayLogSite::ResolveAll() {
+  std::lock_guard<std::mutex> lock(log_sites_mutex);
+  for (RayLogSite* site : log_sites) {
+    site->Resolve();
+  }
+  // The sites filter now, so the logger must let the lowest enabled level through.
+  RayLogLevel lowest = RayLog::severity_threshold_.load(std::memory_order_relaxed);
+  for (const auto& rule : log_level_rules) {
+    lowest = std::min(lowest, rule.level);
+  }
+  // Without a published logger there is nothing of ours to adjust: the default
+  // spdlog logger belongs to the application.
+  spdlog::logger* logger = RayLog::GetLogger();
+  if (logger != nullptr) {
+    logger->set_level(static_cast<spdlog::level::level_enum>(GetMappedSeverity(lowest)));
+  }
+}
+
+static std::string TrimSpaces(const std::string& text) {
+  const size_t first = text.find_first_not_of(" \t");
+  if (first == std::string::npos) {
+    return std::string();
+  }
+  return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+bool RayLog::SetLogLevelSpec(const std::string& spec) {
+  std::vector<LogLevelRule> rules;
+  bool                      parsed = true;
+  std::stringstream         stream(spec);
+  std::string               rule;
+  while (std::getline(stream, rule, ',')) {
+    const size_t equal = rule.rfind('=');
+    if (equal == std::string::npos) {
+      if (!TrimSpaces(rule).empty()) {
+        RAY_LOG(WARNING) << "Missing level in log level spec rule: " << rule;
+        parsed = false;
+      }
+      continue;
+    }
+    LogLevelRule level_rule;
+    level_rule.pattern = TrimSpaces(rule.substr(0, equal));
+    if (level_rule.pattern.empty() || !ParseRayLogLevel(TrimSpaces(rule.substr(equal + 1)), level_rule.level)) {
+      RAY_LOG(WARNING) << "Unrecognized log level spec rule: " << rule;
+      parsed = false;
+      continue;
+    }
+    rules.push_back(std::move(level_rule));
+  }
+  {
+    std::lock_guard<std::mutex> lock(log_sites_mutex);
+    log_level_rules = std::move(rules);
+  }
+  RayLogSite::ResolveAll();
+  return parsed;
+}
+
+/// Levels of named loggers changed at run time: [loggers] entries of the log level
+/// file, and get_logger_st loggers whose .cnf turned them off. Kept by name, so
+/// loggers created later get them too.
+static std::mutex                                                 logger_levels_mutex;
+static std::unordered_map<std::string, spdlog::level::level_enum> logger_level_overrides;
+/// Disabled loggers, with the level to restore once they are enabled again,
+/// unknown until a logger of that name exists.
+static std::unordered_map<std::string, std::optional<spdlog::level::level_enum>> disabled_loggers;
+
+/// Give a new logger the level it was changed to at run time, if any.
+static void ApplyLoggerLevel(spdlog::logger& logger) {
+  std::lock_guard<std::mutex> lock(logger_levels_mutex);
+  auto                        override_it = logger_level_overrides.find(logger.name());
+  if (override_it != logger_level_overrides.end()) {
+    logger.set_level(override_it->second);
+  }
+  auto disabled_it = disabled_loggers.find(logger.name());
+  if (disabled_it != disabled_loggers.end()) {
+    if (!disabled_it->second) {
+      disabled_it->second = logger.level();
+    }
+    logger.set_level(spdlog::level::off);
+  }
+}
+
+/// Turn the logger `name` off, or back to the level it had.
+static void SetLoggerEnabled(const std::string& name, bool enabled) {
+  std::lock_guard<std::mutex>     lock(logger_levels_mutex);
+  std::shared_ptr<spdlog::logger> logger = spdlog::get(name);
+  if (!enabled) {
+    auto inserted = disabled_loggers.emplace(name, std::nullopt);
+    if (inserted.second && logger != nullptr) {
+      inserted.first->second = logger->level();
+      logger->set_level(spdlog::level::off);
+    }
+    return;
+  }
+  auto disabled_it = disabled_loggers.find(name);
+  if (disabled_it == disabled_loggers.end()) {
+    return;
+  }
+  if (logger != nullptr && disabled_it->second) {
+    logger->set_level(*disabled_it->second);
+  }
+  disabled_loggers.erase(disabled_it);
+}
 
-std::string RayLog::GetLogFormatPattern() { return log_format_pattern_; }
+/// Set the level of the logger `name`, now or once it is enabled or created.
+static void SetLoggerLevel(const std::string& name, spdlog::level::level_enum level) {
+  std::lock_guard<std::mutex> lock(logger_levels_mutex);
+  logger_level_overrides[name] = level;
+  auto disabled_it             = disabled_loggers.find(name);
+  if (disabled_it != disabled_loggers.end()) {
+    disabled_it->second = level;
+    return;
+  }
+  std::shared_ptr<spdlog::logger> logger = spdlog::get(name);
+  if (logger != nullptr) {
+    logger->set_level(level);
+  }
+}
 
-std::string RayLog::GetLoggerName() { return logger_name_; }
+static void ApplyLogLevelFile(const std::string& path) {
+  ConfigFile config(path);
+  // Missing entries are not defaults to write back.
+  config.DiscardChanges();
+
+  // In name order, so the threshold is set before the spec.
+  for (const ConfigFile::Entry* entry : config.Entries("RayLog")) {
+    if (entry->name == "level") {
+      RayLogLevel severity_threshold;
+      if (ParseRayLogLevel(entry->value, severity_threshold)) {
+        RayLog::SetLogLevel(severity_threshold);
+      } else {
+        RAY_LOG(WARNING) << "Unrecognized log level in " << path << ": " << entry->value;
+      }
+    } else if (entry->name == "spec") {
+      RayLog::SetLogLevelSpec(entry->value);
+    }
+  }
+
+  for (const ConfigFile::Entry* entry : config.Entries("loggers")) {
+    std::string value = entry->value;
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    spdlog::level::level_enum logger_level = spdlog::level::off;
+    RayLogLevel               severity;
+    if (ParseRayLogLevel(value, severity)) {
+      logger_level = static_cast<spdlog::level::level_enum>(GetMappedSeverity(severity));
+    } else if (value != "off") {
+      RAY_LOG(WARNING) << "Unrecognized level of logger " << entry->name << " in " << path << ": " << entry->value;
+      continue;
+    }
+    SetLoggerLevel(std::string(entry->name), logger_level);
+  }
+}
+
+void RayLog::WatchLogLevelFile(const std::string& path) {
+  if (!log_level_file_.empty() && log_level_file_ != path) {
+    ConfigWatcher::Instance().Unwatch(log_level_file_);
+  }
+  log_level_file_ = path;
+  ApplyLogLevelFile(path);
+  ConfigWatcher::Instance().Watch(path, ApplyLogLevelFile);
+}
+
+std::string RayLog::GetLogFormatPattern() { return State().log_format_pattern; }
+
+void RayLog::SetLogFormatPattern(const std::string& pattern) {
+  UpdateState([&pattern](RayLogState& state) { state.log_format_pattern = pattern; });
+  spdlog::logger* logger = GetLogger();
+  if (logger != nullptr) {
+    logger->set_pattern(pattern);
+  }
+}
+
+std::string RayLog::GetLoggerName() { return State().logger_name; }
+
+spdlog::logger* RayLog::GetLogger() { return State().logger.get(); }
+
+/// Render the text of a deferred record, without the "file:line: " prefix.
+static void RenderDeferredText(const DeferredLogFormat& format, const char* data, fmt::memory_buffer& out) {
+  // Reused across records: clear() keeps the capacity of the argument vectors.
+  thread_local DeferredArgStore store;
+  store.clear();
+  for (size_t i = 0; i < format.arg_count; ++i) {
+    data = format.decoders[i](data, store);
+  }
+  try {
+    fmt::vformat_to(std::back_inserter(out), format.format, store);
+  } catch (const fmt::format_error& ex) {
+    fmt::format_to(std::back_inserter(out), "<bad log format \"{}\": {}>", format.format, ex.what());
+  }
+}
+
+void RenderDeferredLog(const DeferredLogFormat& format, const char* data, fmt::memory_buffer& out) {
+  const char*            basename  = format.site->Basename();
+  const std::string_view line_text = format.site->LineText();
+  out.append(basename, basename + strlen(basename));
+  out.append(line_text.data(), line_text.data() + line_text.size());
+  RenderDeferredText(format, data, out);
+}
+
+void PostDeferredLog(RayLogLevel severity, const DeferredLogFormat& format, const char* data, size_t size) {
+  const auto       level   = static_cast<spdlog::level::level_enum>(GetMappedSeverity(severity));
+  AsyncLogBackend* backend = async_log_backend.load(std::memory_order_acquire);
+  if (backend != nullptr && severity != RayLogLevel::FATAL) {
+    if (crash_ring.load(std::memory_order_relaxed) != nullptr) {
+      // Rendering is the writer's job: the crash ring gets the format string.
+      fmt::basic_memory_buffer<char, 256> text;
+      const char*                         basename  = format.site->Basename();
+      const std::string_view              line_text = format.site->LineText();
+      text.append(basename, basename + strlen(basename));
+      text.append(line_text.data(), line_text.data() + line_text.size());
+      text.append(format.format.data(), format.format.data() + format.format.size());
+      AppendToCrashRing(level, spdlog::string_view_t(text.data(), text.size()));
+    }
+    backend->PostDeferred(level, format, spdlog::string_view_t(data, size));
+    return;
+  }
+  fmt::memory_buffer rendered;
+  if (severity == RayLogLevel::FATAL) {
+    // Go through RayLog so fatal callbacks run and the process exits as with RAY_LOG(FATAL).
+    RenderDeferredText(format, data, rendered);
+    RayLog(format.site->File(), format.site->Line(), severity) << std::string_view(rendered.data(), rendered.size());
+    return;
+  }
+  RenderDeferredLog(format, data, rendered);
+  DispatchLogMessage(level, spdlog::string_view_t(rendered.data(), rendered.size()),
+                     spdlog::source_loc(format.site->Basename(), format.site->Line(), nullptr));
+}
+
+uint64_t RayLog::GetDroppedLogCount() {
+  AsyncLogBackend* backend = async_log_backend.load(std::memory_order_acquire);
+  return backend != nullptr ? backend->DroppedCount() : 0;
+}
+
+uint64_t RayLog::GetRateLimitedLogCount() { return RateLimitCounters()->dropped.load(std::memory_order_relaxed); }
+
+uint64_t RayLog::GetDuplicateLogCount() { return RateLimitCounters()->duplicates.load(std::memory_order_relaxed); }
+
+std::vector<RayLogSiteCount> RayLog::GetLogSiteCounts() {
+  std::lock_guard<std::mutex>  lock(log_sites_mutex);
+  std::vector<RayLogSiteCount> counts;
+  counts.reserve(log_sites.size());
+  for (const RayLogSite* site : log_sites) {
+    counts.push_back({site->id_, site->file_, site->line_, site->module_, site->level_,
+                      site->records_.load(std::memory_order_relaxed)});
+  }
+  return counts;
+}
 
 void RayLog::AddFatalLogCallbacks(const std::vector<FatalLogCallback>& expose_log_callbacks) {
-  fatal_log_callbacks_.insert(fatal_log_callbacks_.end(), expose_log_callbacks.begin(), expose_log_callbacks.end());
+  UpdateState([&expose_log_callbacks](RayLogState& state) {
+    state.fatal_log_callbacks.insert(state.fatal_log_callbacks.end(), expose_log_callbacks.begin(),
+                                     expose_log_callbacks.end());
+  });
 }
 
 RayLog::RayLog(const char* file_name, int line_number, RayLogLevel severity)
-    : logging_provider_(nullptr), is_enabled_(severity >= severity_threshold_), severity_(severity),
+    : RayLog(file_name, line_number, severity, severity >= severity_threshold_.load(std::memory_order_relaxed)) {}
+
+RayLog::RayLog(const char* file_name, int line_number, RayLogLevel severity, bool is_enabled)
+    : RayLog(RayLogSite(file_name, line_number, "", severity), severity, is_enabled) {}
+
+// RAY_LOG checked the site already; RAY_DCHECK did not, and registers it here.
+RayLog::RayLog(RayLogSite& site) : RayLog(site, site.Level(), site.IsEnabled()) {
+  if (is_enabled_) {
+    site.AddRecord();
+  }
+}
+
+RayLog::RayLog(const RayLogSite& site, RayLogLevel severity, bool is_enabled)
+    : logging_provider_(nullptr), is_enabled_(is_enabled), severity_(severity),
       is_fatal_(severity == RayLogLevel::FATAL) {
   if (is_fatal_) {
     expose_osstream_ = std::make_shared<std::ostringstream>();
-    *expose_osstream_ << file_name << ":" << line_number << ":";
+    *expose_osstream_ << site.File() << ":" << site.Line() << ":";
   }
   if (is_enabled_) {
-    logging_provider_ = new LoggingProvider(file_name, line_number, GetMappedSeverity(severity), expose_osstream_);
+    logging_provider_ = LoggingProvider::Acquire(site, GetMappedSeverity(severity), expose_osstream_);
   }
 }
 
@@ -330,11 +1291,11 @@ std::ostream& RayLog::ExposeStream() { return *expose_osstream_; }
 
 RayLog::~RayLog() {
   if (logging_provider_ != nullptr) {
-    delete reinterpret_cast<LoggingProvider*>(logging_provider_);
+    LoggingProvider::Release(reinterpret_cast<LoggingProvider*>(logging_provider_));
     logging_provider_ = nullptr;
   }
   if (expose_osstream_ != nullptr) {
-    for (const auto& callback : fatal_log_callbacks_) {
+    for (const auto& callback : State().fatal_log_callbacks) {
       callback(EL_RAY_FATAL_CHECK_FAILED, expose_osstream_->str());
     }
   }
@@ -371,11 +1332,160 @@ std::string printable_current_time() {
                      "", get_current_time_str(), banner_spaces);
 }
 
+static std::mutex            logger_st_options_mutex;
+static ray::RayLogFlushPolicy logger_st_flush_policy;
+static ray::RayLogRateLimit   logger_st_rate_limit;
+
+void set_logger_st_flush_policy(const ray::RayLogFlushPolicy& flush_policy) {
+  std::lock_guard<std::mutex> lock(logger_st_options_mutex);
+  logger_st_flush_policy = flush_policy;
+}
+
+void set_logger_st_rate_limit(const ray::RayLogRateLimit& rate_limit) {
+  std::lock_guard<std::mutex> lock(logger_st_options_mutex);
+  logger_st_rate_limit = rate_limit;
+}
+
+/// Parsed .cnf files of get_logger_st, keyed by path, so a call costs a stat()
+/// instead of opening and parsing the file. An entry is parsed again when the
+/// modification time or size of its file changes. Defaults added to an entry are
+/// written back once, kConfigSaveDelay after the first of them, by the periodic
+/// flusher thread, and at exit.
+/// Every file is also watched: when it changes, the loggers already asked about
+/// are turned off or back on without waiting for the next get_logger_st call.
+class ConfigFileCache final : private vtpl::details::flush_target {
+public:
+  static ConfigFileCache& Instance() {
+    // Never destroyed: the atexit save and the flusher thread may still use it.
+    static auto* cache = [] {
+      auto* instance = new ConfigFileCache();
+      vtpl::details::periodic_flusher::instance().add(instance, kConfigSaveDelay);
+      std::atexit([] { Instance().SaveAll(); });
+      return instance;
+    }();
+    return *cache;
+  }
+
+  /// Whether the configuration of `path` enables `logger_name`, adding missing
+  /// entries as enabled. The logger is turned off or on to match.
+  bool LoggerEnabled(const std::string& path, const std::string& base_name, const std::string& logger_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry&                      entry   = Refresh(path);
+    const bool                  enabled = Enabled(*entry.config, base_name, logger_name);
+    entry.loggers.emplace(logger_name, base_name);
+    MarkDirty(entry);
+    ray::SetLoggerEnabled(logger_name, enabled);
+    return enabled;
+  }
+
+private:
+  static constexpr std::chrono::milliseconds kConfigSaveDelay{1000};
+
+  struct Entry {
+    std::unique_ptr<ConfigFile>           config;
+    ray::ConfigFileStamp                  stamp;
+    bool                                  dirty{false};
+    std::chrono::steady_clock::time_point dirty_since;
+    /// Logger names asked about, with their base names.
+    std::map<std::string, std::string>    loggers;
+  };
+
+  ConfigFileCache() = default;
+
+  static bool Enabled(ConfigFile& config, const std::string& base_name, const std::string& logger_name) {
+    bool enabled = static_cast<double>(config.Value(base_name, base_name, 1.0)) > 0;
+    if (logger_name != base_name) {
+      enabled = static_cast<double>(config.Value(base_name, logger_name, 1.0)) > 0 || enabled;
+    }
+    return enabled;
+  }
+
+  /// The entry of `path`, parsed again if the file changed.
+  Entry& Refresh(const std::string& path) {
+    auto                       it    = entries_.find(path);
+    const ray::ConfigFileStamp stamp = ray::ConfigFileStamp::Of(path);
+    if (it == entries_.end()) {
+      it = entries_.emplace(path, Entry()).first;
+      ray::ConfigWatcher::Instance().Watch(path, [](const std::string& changed) { Instance().Reload(changed); });
+    }
+    Entry& entry = it->second;
+    if (entry.config == nullptr || stamp != entry.stamp) {
+      // The old parse is dropped unsaved: the file on disk wins.
+      if (entry.config != nullptr) {
+        entry.config->DiscardChanges();
+      }
+      entry.config = std::make_unique<ConfigFile>(path);
+      entry.stamp  = stamp;
+      entry.dirty  = false;
+    }
+    return entry;
+  }
+
+  void MarkDirty(Entry& entry) {
+    if (!entry.dirty && entry.config->NeedsSave()) {
+      entry.dirty       = true;
+      entry.dirty_since = std::chrono::steady_clock::now();
+    }
+  }
+
+  /// Called by the config watcher when `path` changed on disk.
+  void Reload(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry&                      entry = Refresh(path);
+    for (const auto& it : entry.loggers) {
+      ray::SetLoggerEnabled(it.first, Enabled(*entry.config, it.second, it.first));
+    }
+    MarkDirty(entry);
+  }
+
+  void SaveLocked(const std::string& path, Entry& entry) {
+    if (entry.config->Save()) {
+      // Our own write must not count as a change on disk.
+      entry.stamp = ray::ConfigFileStamp::Of(path);
+    }
+    entry.dirty = false;
+  }
+
+  void SaveAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& it : entries_) {
+      if (it.second.dirty) {
+        SaveLocked(it.first, it.second);
+      }
+    }
+  }
+
+  void flush_if_due(std::chrono::steady_clock::time_point now) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& it : entries_) {
+      if (it.second.dirty && now - it.second.dirty_since >= kConfigSaveDelay) {
+        SaveLocked(it.first, it.second);
+      }
+    }
+  }
+
+  std::mutex                             mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
 std::shared_ptr<spdlog::logger> get_logger_st_internal(const std::string& logger_name, const std::string& logger_path) {
   std::shared_ptr<spdlog::logger> logger = spdlog::get(logger_name);
   if (logger == nullptr) {
-    logger = spdlog::rotating_logger_st(logger_name, logger_path, max_size, max_files);
+    ray::RayLogFlushPolicy flush_policy;
+    ray::RayLogRateLimit   rate_limit;
+    {
+      std::lock_guard<std::mutex> lock(logger_st_options_mutex);
+      flush_policy = logger_st_flush_policy;
+      rate_limit   = logger_st_rate_limit;
+    }
+    // The single-threaded file sink is only reached through the policy sink, whose
+    // mutex also serialises the background interval flush against writes.
+    auto file_sink = ray::MakeRotatingFileSink<spdlog::details::null_mutex>(logger_path, max_size, max_files);
+    auto sinks     = ray::WithRateLimit({ray::WithFlushPolicy(file_sink, flush_policy)}, rate_limit);
+    logger         = std::make_shared<spdlog::logger>(logger_name, sinks.begin(), sinks.end());
+    spdlog::initialize_logger(logger);
     logger->set_pattern("%v");
+    ray::ApplyLoggerLevel(*logger);
   }
   return logger;
 }
@@ -396,18 +1506,10 @@ std::shared_ptr<spdlog::logger> get_logger_st(const std::string& session_folder,
     base_path_cnf << ".cnf";
     // Poco::Path base_path_cnf(session_folder);
     // base_path_cnf.append(fmt::format("{}.cnf", logger_name));
-    ConfigFile f(base_path_cnf.str());
-    auto       d = static_cast<double>(f.Value(base_name, logger_name, 1.0));
-    if (d > 0) {
-      enable_logging = true;
-    }
     if ((channel_id != 0) || (app_id != 0)) {
       logger_name = fmt::format("{}_{}_{}", logger_name, channel_id, app_id);
     }
-    d = static_cast<double>(f.Value(base_name, logger_name, 1.0));
-    if (d > 0) {
-      enable_logging = true;
-    }
+    enable_logging = ConfigFileCache::Instance().LoggerEnabled(base_path_cnf.str(), base_name, logger_name);
   }
   if (enable_logging) {
     std::stringstream base_path_log;
@@ -434,7 +1536,6 @@ void write_header(std::shared_ptr<spdlog::logger> logger, const std::string& hea
 void write_log(std::shared_ptr<spdlog::logger> logger, const std::string& log_msg) {
   if (logger) {
     logger->info(log_msg);
-    logger->flush();
   }
 }
 std::string get_current_time_str() {
@@ -0,0 +1,16 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+#include "common.h"
+
+#ifndef VTPL_COMPILED_LIB
+#error Please define VTPL_COMPILED_LIB to compile this file.
+#endif
+
+#include "sinks/binary_file_sink.h"
+#include <mutex>
+#include <spdlog/details/null_mutex.h>
+
+#include "sinks/binary_file_sink-inl.h"
+template class VTPL_API vtpl::sinks::binary_file_sink<std::mutex>;
+template class VTPL_API vtpl::sinks::binary_file_sink<spdlog::details::null_mutex>;
@@ -0,0 +1,17 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+#include "common.h"
+
+#ifndef VTPL_COMPILED_LIB
+#error Please define VTPL_COMPILED_LIB to compile this file.
+#endif
+
+#include "sinks/flush_policy_sink.h"
+#include <mutex>
+#include <spdlog/details/null_mutex.h>
+
+#include "details/periodic_flusher-inl.h"
+#include "sinks/flush_policy_sink-inl.h"
+template class VTPL_API vtpl::sinks::flush_policy_sink<std::mutex>;
+template class VTPL_API vtpl::sinks::flush_policy_sink<spdlog::details::null_mutex>;
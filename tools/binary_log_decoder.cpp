@@ -0,0 +1,272 @@
+// *****************************************************
+//  Copyright 2024 Videonetics Technology Pvt Ltd
+// *****************************************************
+
+// Renders files written by vtpl::sinks::binary_file_sink (RAY_BACKEND_LOG_BINARY=1)
+// and RayLog crash rings (*.crash, oldest record first) as text, one record per
+// line, to stdout.
+//
+// usage: binary_log_decoder [--pattern <spdlog pattern>] file...
+//
+// The default pattern is the RayLog one; %P prints the process id of the writer.
+
+#include "details/binary_log_format.h"
+#include "details/crash_ring_buffer.h"
+
+#include <spdlog/details/fmt_helper.h>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/pattern_formatter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+namespace binary_log = vtpl::details::binary_log;
+
+constexpr const char* kDefaultPattern = "[%Y-%m-%d %H:%M:%S,%e %L %P %t] %v";
+
+/// %P of the process that wrote the file, not of the decoder.
+class WriterPidFlag final : public spdlog::custom_flag_formatter {
+public:
+  explicit WriterPidFlag(const uint32_t* pid) : pid_(pid) {}
+
+  void format(const spdlog::details::log_msg& /*msg*/, const std::tm& /*tm_time*/,
+              spdlog::memory_buf_t& dest) override {
+    spdlog::details::fmt_helper::append_int(*pid_, dest);
+  }
+
+  std::unique_ptr<custom_flag_formatter> clone() const override { return std::make_unique<WriterPidFlag>(pid_); }
+
+private:
+  const uint32_t* pid_;
+};
+
+struct SourceLocation {
+  int         line{0};
+  std::string file;
+  std::string function;
+};
+
+class Decoder {
+public:
+  explicit Decoder(const std::string& pattern) {
+    formatter_ = std::make_unique<spdlog::pattern_formatter>();
+    formatter_->add_flag<WriterPidFlag>('P', &pid_).set_pattern(pattern);
+  }
+
+  /// Print the records of `path`. Returns false, after printing what could be
+  /// decoded, if the file is not a binary log or is corrupt.
+  bool Decode(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+      return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const char*       in  = data.data();
+    const char*       end = in + data.size();
+
+    if (data.size() >= sizeof(ray::CrashRingHeader) &&
+        std::memcmp(in, ray::kCrashRingMagic, sizeof(ray::kCrashRingMagic)) == 0) {
+      return DecodeCrashRing(path, data);
+    }
+    if (data.size() < binary_log::header_size || std::memcmp(in, binary_log::magic, sizeof(binary_log::magic)) != 0) {
+      std::fprintf(stderr, "%s: not a binary log file\n", path.c_str());
+      return false;
+    }
+    in += sizeof(binary_log::magic);
+    const auto version = static_cast<uint8_t>(*in++);
+    if (version != binary_log::version) {
+      std::fprintf(stderr, "%s: unsupported format version %u\n", path.c_str(), static_cast<unsigned>(version));
+      return false;
+    }
+    time_ns_ = static_cast<int64_t>(binary_log::get_fixed(in, 8));
+    in += 8;
+    pid_ = static_cast<uint32_t>(binary_log::get_fixed(in, 4));
+    in += 4;
+    loggers_.clear();
+    sources_.clear();
+
+    while (in < end) {
+      uint64_t size = 0;
+      if (!binary_log::get_varint(in, end, size) || size == 0 || size > static_cast<uint64_t>(end - in)) {
+        // A record cut short by a crash is expected at the end of the file.
+        std::fprintf(stderr, "%s: truncated at offset %zu\n", path.c_str(), static_cast<size_t>(in - data.data()));
+        return false;
+      }
+      const char* body_end = in + size;
+      if (!DecodeEntry(in + 1, body_end, static_cast<binary_log::entry_type>(*in))) {
+        std::fprintf(stderr, "%s: corrupt entry at offset %zu\n", path.c_str(), static_cast<size_t>(in - data.data()));
+        return false;
+      }
+      in = body_end;
+    }
+    return true;
+  }
+
+private:
+  bool DecodeCrashRing(const std::string& path, const std::string& data) {
+    // Read the fields by offset: the file holds atomics, which are not copied.
+    const char* header     = data.data();
+    uint32_t    version    = 0;
+    uint32_t    slot_size  = 0;
+    uint32_t    slot_count = 0;
+    std::memcpy(&version, header + offsetof(ray::CrashRingHeader, version), sizeof(version));
+    std::memcpy(&slot_size, header + offsetof(ray::CrashRingHeader, slot_size), sizeof(slot_size));
+    std::memcpy(&slot_count, header + offsetof(ray::CrashRingHeader, slot_count), sizeof(slot_count));
+    std::memcpy(&pid_, header + offsetof(ray::CrashRingHeader, pid), sizeof(pid_));
+    if (version != ray::kCrashRingVersion || slot_size != ray::kCrashRingSlotSize || slot_count == 0 ||
+        data.size() < sizeof(ray::CrashRingHeader) + static_cast<size_t>(slot_count) * slot_size) {
+      std::fprintf(stderr, "%s: unsupported or truncated crash ring\n", path.c_str());
+      return false;
+    }
+
+    // (sequence, slot) of every complete record, in the order they were written.
+    std::vector<std::pair<uint64_t, const char*>> records;
+    for (uint32_t i = 0; i < slot_count; ++i) {
+      const char* slot     = header + sizeof(ray::CrashRingHeader) + static_cast<size_t>(i) * slot_size;
+      uint64_t    sequence = 0;
+      std::memcpy(&sequence, slot + offsetof(ray::CrashRingSlot, sequence), sizeof(sequence));
+      if (sequence != 0 && (sequence - 1) % slot_count == i) {
+        records.emplace_back(sequence, slot);
+      }
+    }
+    std::sort(records.begin(), records.end());
+
+    for (const auto& record : records) {
+      const char* slot      = record.second;
+      int64_t     time_ns   = 0;
+      uint64_t    thread_id = 0;
+      uint16_t    size      = 0;
+      int8_t      level     = 0;
+      std::memcpy(&time_ns, slot + offsetof(ray::CrashRingSlot, time_ns), sizeof(time_ns));
+      std::memcpy(&thread_id, slot + offsetof(ray::CrashRingSlot, thread_id), sizeof(thread_id));
+      std::memcpy(&size, slot + offsetof(ray::CrashRingSlot, size), sizeof(size));
+      std::memcpy(&level, slot + offsetof(ray::CrashRingSlot, level), sizeof(level));
+      if (!IsLevel(level)) {
+        continue;
+      }
+      size = std::min<uint16_t>(size, sizeof(ray::CrashRingSlot::text));
+      const auto time = spdlog::log_clock::time_point(
+          std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(time_ns)));
+      Print(time, spdlog::source_loc{}, std::string(), static_cast<spdlog::level::level_enum>(level), thread_id,
+            spdlog::string_view_t(slot + offsetof(ray::CrashRingSlot, text), size));
+    }
+    return true;
+  }
+
+  void Print(spdlog::log_clock::time_point time, const spdlog::source_loc& source, const std::string& logger_name,
+             spdlog::level::level_enum level, uint64_t thread_id, spdlog::string_view_t payload) {
+    spdlog::details::log_msg msg(time, source, logger_name, level, payload);
+    msg.thread_id = static_cast<size_t>(thread_id);
+    formatted_.clear();
+    formatter_->format(msg, formatted_);
+    std::fwrite(formatted_.data(), 1, formatted_.size(), stdout);
+  }
+
+  /// True if `level` is a spdlog level, so its name can be looked up.
+  static bool IsLevel(int level) { return level >= 0 && level < spdlog::level::n_levels; }
+
+  static bool GetString(const char*& in, const char* end, std::string& value) {
+    uint64_t size = 0;
+    if (!binary_log::get_varint(in, end, size) || size > static_cast<uint64_t>(end - in)) {
+      return false;
+    }
+    value.assign(in, static_cast<size_t>(size));
+    in += size;
+    return true;
+  }
+
+  bool DecodeEntry(const char* in, const char* end, binary_log::entry_type type) {
+    uint64_t id = 0;
+    switch (type) {
+    case binary_log::entry_type::logger_name:
+      return binary_log::get_varint(in, end, id) && GetString(in, end, loggers_[id]);
+    case binary_log::entry_type::source_location: {
+      uint64_t line = 0;
+      if (!binary_log::get_varint(in, end, id) || !binary_log::get_varint(in, end, line)) {
+        return false;
+      }
+      SourceLocation& source = sources_[id];
+      source.line            = static_cast<int>(line);
+      return GetString(in, end, source.file) && GetString(in, end, source.function);
+    }
+    case binary_log::entry_type::record:
+      return DecodeRecord(in, end);
+    }
+    // Written by a newer version: skip it.
+    return true;
+  }
+
+  bool DecodeRecord(const char* in, const char* end) {
+    uint64_t delta     = 0;
+    uint64_t thread_id = 0;
+    uint64_t logger_id = 0;
+    uint64_t source_id = 0;
+    uint64_t size      = 0;
+    if (!binary_log::get_varint(in, end, delta) || in == end) {
+      return false;
+    }
+    const int level = static_cast<unsigned char>(*in++);
+    if (!IsLevel(level) || !binary_log::get_varint(in, end, thread_id) || !binary_log::get_varint(in, end, logger_id) ||
+        !binary_log::get_varint(in, end, source_id) || !binary_log::get_varint(in, end, size) ||
+        size > static_cast<uint64_t>(end - in)) {
+      return false;
+    }
+    time_ns_ += binary_log::zigzag_decode(delta);
+
+    spdlog::source_loc source;
+    auto               it = sources_.find(source_id);
+    if (it != sources_.end()) {
+      source = spdlog::source_loc(it->second.file.c_str(), it->second.line, it->second.function.c_str());
+    }
+    const auto time = spdlog::log_clock::time_point(
+        std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(time_ns_)));
+    Print(time, source, loggers_[logger_id], static_cast<spdlog::level::level_enum>(level), thread_id,
+          spdlog::string_view_t(in, static_cast<size_t>(size)));
+    return true;
+  }
+
+  std::unique_ptr<spdlog::pattern_formatter>   formatter_;
+  spdlog::memory_buf_t                         formatted_;
+  uint32_t                                     pid_{0};
+  int64_t                                      time_ns_{0};
+  std::unordered_map<uint64_t, std::string>    loggers_;
+  std::unordered_map<uint64_t, SourceLocation> sources_;
+};
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+  std::string pattern = kDefaultPattern;
+  int         first   = 1;
+  if (argc > 2 && std::strcmp(argv[1], "--pattern") == 0) {
+    pattern = argv[2];
+    first   = 3;
+  }
+  if (first >= argc) {
+    std::fprintf(stderr, "usage: %s [--pattern <spdlog pattern>] file...\n", argv[0]);
+    return 2;
+  }
+
+  Decoder decoder(pattern);
+  int     status = 0;
+  for (int i = first; i < argc; ++i) {
+    if (!decoder.Decode(argv[i])) {
+      status = 1;
+    }
+  }
+  return status;
+}